@@ -49,6 +49,40 @@ extern "C" {
 typedef struct ACAP_HTTP_Request_T*  ACAP_HTTP_Request;
 typedef struct ACAP_HTTP_Response_T* ACAP_HTTP_Response;
 
+/*-----------------------------------------------------
+ * Opaque Event View
+ *
+ * A subscribed event decoded without building a cJSON tree.
+ * Use the ACAP_EVENT_* accessor functions to read it.
+ *-----------------------------------------------------*/
+typedef struct ACAP_Event_T* ACAP_Event;
+
+/** Handle to a declared event, see ACAP_EVENTS_Get_Handle() */
+typedef struct ACAP_EVENT_Handle_T* ACAP_EVENT_Handle;
+
+/** One entry for ACAP_EVENTS_Fire_Batch() */
+typedef struct {
+    const char*       id;       /**< Event identifier, used when handle is NULL */
+    ACAP_EVENT_Handle handle;   /**< Handle from ACAP_EVENTS_Get_Handle(), or NULL */
+    int               state;    /**< Stateful: new state. Stateless: nonzero fires the event */
+} ACAP_EVENT_Update;
+
+/** Value types returned by ACAP_EVENT_Type() */
+typedef enum {
+    ACAP_EVENT_NONE = 0,    /**< Property missing or has no value */
+    ACAP_EVENT_INT,
+    ACAP_EVENT_BOOL,
+    ACAP_EVENT_DOUBLE,
+    ACAP_EVENT_STRING
+} ACAP_EVENT_Value_Type;
+
+/** Overflow policies for the event dispatch queue, see ACAP_EVENTS_SetDispatch() */
+typedef enum {
+    ACAP_EVENTS_DROP_OLDEST = 0,    /**< Discard the oldest queued event */
+    ACAP_EVENTS_DROP_NEWEST,        /**< Discard the incoming event */
+    ACAP_EVENTS_BLOCK               /**< Wait for a worker to free a slot */
+} ACAP_EVENTS_Overflow;
+
 /*-----------------------------------------------------
  * Callback Types
  *-----------------------------------------------------*/
@@ -65,11 +99,21 @@ typedef void (*ACAP_Config_Update)(const char* service, cJSON* data);
 
 /**
  * @brief Callback function type for subscribed events.
- * @param event The event data (caller must NOT delete - handled internally)
+ * @param event The event data (caller must NOT delete - handled internally).
+ *              Freed when the callback returns; detach or cJSON_Duplicate()
+ *              anything that must be kept.
  * @param user_data User-provided context from ACAP_EVENTS_Subscribe
  */
 typedef void (*ACAP_EVENTS_Callback)(cJSON* event, void* user_data);
 
+/**
+ * @brief Callback function type for subscribed events, typed view.
+ * @param event The event view. It and every string read from it are only
+ *              valid during the callback; use ACAP_EVENT_JSON() to keep it.
+ * @param user_data User-provided context from ACAP_EVENTS_Subscribe
+ */
+typedef void (*ACAP_EVENTS_View_Callback)(const ACAP_Event event, void* user_data);
+
 /**
  * @brief HTTP endpoint callback function type.
  * @param response The response object to write data to
@@ -264,8 +308,12 @@ char* ACAP_HTTP_Request_Param(const ACAP_HTTP_Request request, const char* param
 
 /**
  * @brief Get a query parameter and parse it as JSON.
+ *
+ * With param NULL the POST body is parsed instead; it must be sent as
+ * application/json or application/cbor.
+ *
  * @param request The HTTP request object
- * @param param The parameter name
+ * @param param The parameter name, or NULL for the body
  * @return Parsed cJSON object (caller must cJSON_Delete), or NULL
  */
 cJSON* ACAP_HTTP_Request_JSON(const ACAP_HTTP_Request request, const char* param);
@@ -318,7 +366,9 @@ int ACAP_HTTP_Respond_String(ACAP_HTTP_Response response, const char* fmt, ...);
 /**
  * @brief Send a JSON object as the response body.
  *
- * Automatically sets Content-Type: application/json header.
+ * Automatically sets Content-Type: application/json header. Clients whose
+ * Accept header names application/cbor (with a nonzero q no lower than that of
+ * application/json) get the object CBOR-encoded instead.
  *
  * @param response The HTTP response object
  * @param object The cJSON object to serialize and send (not consumed, caller still owns it)
@@ -363,11 +413,14 @@ int ACAP_HTTP_Respond_Text(ACAP_HTTP_Response response, const char* message);
  * @brief Declare a simple stateful or stateless event.
  *
  * Creates an AXIS event under CameraApplicationPlatform/<AppName>/<Id>
+ * The declaration completes asynchronously; events fired before then are
+ * held and sent once the device has registered it.
  *
  * @param Id Event identifier (used in topic)
  * @param NiceName Human-readable event name shown in camera UI
  * @param state 1 for stateful event (has state property), 0 for stateless (has value property)
- * @return Declaration ID on success, 0 on failure
+ * @return Declaration ID on success, 0 on failure or if Id is already declared
+ *         (remove it with ACAP_EVENTS_Remove_Event() first)
  *
  * Example:
  * @code
@@ -394,7 +447,7 @@ int ACAP_EVENTS_Add_Event(const char* Id, const char* NiceName, int state);
  *        - "state": true for stateful events
  *        - "source": Array of source properties
  *        - "data": Array of data properties
- * @return Declaration ID on success, 0 on failure
+ * @return Declaration ID on success, 0 on failure or if the id is already declared
  */
 int ACAP_EVENTS_Add_Event_JSON(cJSON* event);
 
@@ -408,7 +461,9 @@ int ACAP_EVENTS_Remove_Event(const char* Id);
 /**
  * @brief Fire a stateful event (set state high or low).
  *
- * Only fires if the state actually changes (debounced).
+ * Only fires if the state actually changes (debounced). Safe to call from
+ * several threads. The state is mirrored to the "events" status group
+ * from the main loop shortly after it changes.
  *
  * @param Id The event identifier
  * @param value 1 for high/active, 0 for low/inactive
@@ -416,6 +471,13 @@ int ACAP_EVENTS_Remove_Event(const char* Id);
  */
 int ACAP_EVENTS_Fire_State(const char* Id, int value);
 
+/**
+ * @brief Current state of a stateful event.
+ * @param Id The event identifier
+ * @return 1 if high, 0 if low or not declared
+ */
+int ACAP_EVENTS_Get_State(const char* Id);
+
 /**
  * @brief Fire a stateless event (pulse).
  * @param Id The event identifier
@@ -425,12 +487,83 @@ int ACAP_EVENTS_Fire(const char* Id);
 
 /**
  * @brief Fire an event with custom JSON data payload.
+ *
+ * Properties not present in data keep the value they were last fired with.
+ *
  * @param Id The event identifier
  * @param data JSON object containing the event data properties
  * @return 1 on success, 0 on failure
  */
 int ACAP_EVENTS_Fire_JSON(const char* Id, cJSON* data);
 
+/**
+ * @brief Get the handle of a declared event.
+ *
+ * A handle holds the declaration and a prepared set of the event's data
+ * properties. Set values on it and fire it without any lookup or per-call
+ * setup, e.g. for events fired at frame rate. Values keep their last
+ * setting between fires. The handle is valid until the event is removed.
+ *
+ * @param Id The event identifier
+ * @return Handle, or NULL if the event is not declared
+ *
+ * Example:
+ * @code
+ * ACAP_EVENT_Handle objects = ACAP_EVENTS_Get_Handle("objects");
+ * ...
+ * ACAP_EVENTS_Set_Int(objects, "count", count);
+ * ACAP_EVENTS_Fire_Handle(objects);
+ * @endcode
+ */
+ACAP_EVENT_Handle ACAP_EVENTS_Get_Handle(const char* Id);
+
+/**
+ * @brief Update a property value of a declared event.
+ * @param handle Handle from ACAP_EVENTS_Get_Handle()
+ * @param name Property name as declared ("value", "state" or a data/source property)
+ * @return 1 on success, 0 on failure
+ */
+int ACAP_EVENTS_Set_Int(ACAP_EVENT_Handle handle, const char* name, int value);
+int ACAP_EVENTS_Set_Bool(ACAP_EVENT_Handle handle, const char* name, int value);
+int ACAP_EVENTS_Set_Double(ACAP_EVENT_Handle handle, const char* name, double value);
+int ACAP_EVENTS_Set_String(ACAP_EVENT_Handle handle, const char* name, const char* value);
+
+/**
+ * @brief Fire a declared event with its current property values.
+ * @param handle Handle from ACAP_EVENTS_Get_Handle()
+ * @return 1 on success, 0 on failure
+ */
+int ACAP_EVENTS_Fire_Handle(ACAP_EVENT_Handle handle);
+
+/**
+ * @brief Set the state of a stateful event by handle.
+ *
+ * Same as ACAP_EVENTS_Fire_State() without the id lookup. An unchanged
+ * state costs one atomic read.
+ */
+int ACAP_EVENTS_Fire_State_Handle(ACAP_EVENT_Handle handle, int value);
+
+/**
+ * @brief Apply many event updates in one call.
+ *
+ * Stateful events are only sent when their state changes; stateless
+ * events are fired when their state field is nonzero. The "events"
+ * status group is updated once for the whole batch.
+ *
+ * @param updates Array of updates
+ * @param count Number of entries
+ * @return 1 if every update succeeded, 0 if any failed (the rest are still applied)
+ *
+ * Example:
+ * @code
+ * ACAP_EVENT_Update zones[ZONES];
+ * for (int i = 0; i < ZONES; i++)
+ *     zones[i] = (ACAP_EVENT_Update){ .handle = zoneHandle[i], .state = occupied[i] };
+ * ACAP_EVENTS_Fire_Batch(zones, ZONES);
+ * @endcode
+ */
+int ACAP_EVENTS_Fire_Batch(const ACAP_EVENT_Update* updates, size_t count);
+
 /**
  * @brief Set the global event callback for subscribed events.
  * @param callback Function to call when subscribed events occur
@@ -445,7 +578,19 @@ int ACAP_EVENTS_SetCallback(ACAP_EVENTS_Callback callback);
  *        - "name": Description (required)
  *        - "topic0": {"namespace": "value"} (required)
  *        - "topic1", "topic2", "topic3": Optional additional topic levels
- * @param user_data User context passed to callback (can be NULL)
+ *        Optional delivery options, applied before the event is decoded:
+ *        - "filter": expression on event properties, e.g. "active == true && zone in [1,3]".
+ *          Supports == != < <= > >= in [..] && || ! and parentheses; events that
+ *          do not match are dropped. An invalid expression fails the subscription.
+ *        - "dedupe": true drops events identical to the last one delivered (or held) on the same
+ *          stream (topic and source properties, e.g. the I/O port)
+ *        - "debounceMs": deliver a stream's latest event once it has been quiet this long;
+ *          repeats count as activity
+ *        - "maxRatePerSec": at most this many deliveries per second
+ *        - "coalesce": "latest" keeps the newest rate-limited event and delivers
+ *          it when allowed, instead of dropping it
+ * @param user_data User context passed to callback (can be NULL). If set, it must be a
+ *        cJSON item: the callback's event carries a reference to it as "source".
  * @return Subscription ID on success, 0 on failure
  *
  * Example subscription declaration:
@@ -453,12 +598,39 @@ int ACAP_EVENTS_SetCallback(ACAP_EVENTS_Callback callback);
  * {
  *   "name": "All Motion Events",
  *   "topic0": {"tnsaxis": "VideoAnalytics"},
- *   "topic1": {"tnsaxis": "MotionDetection"}
+ *   "topic1": {"tnsaxis": "MotionDetection"},
+ *   "maxRatePerSec": 5,
+ *   "coalesce": "latest"
  * }
  * @endcode
  */
 int ACAP_EVENTS_Subscribe(cJSON* eventDeclaration, void* user_data);
 
+/**
+ * @brief Subscribe to an event with its own callback.
+ *
+ * Events on this subscription go only to the given callback, not to the
+ * callbacks set with ACAP_EVENTS_SetCallback()/ACAP_EVENTS_SetViewCallback(),
+ * so the callback does not need to match the "event" topic again.
+ *
+ * @param eventDeclaration Same format as ACAP_EVENTS_Subscribe()
+ * @param callback Called for every event on this subscription
+ * @param user_data Any context pointer, passed to callback untouched (can be NULL)
+ * @param options Optional object overriding the delivery options of the
+ *        declaration ("filter", "dedupe", "debounceMs", "maxRatePerSec", "coalesce"), or NULL
+ * @return Subscription ID on success, 0 on failure
+ */
+int ACAP_EVENTS_Subscribe_With(cJSON* eventDeclaration, ACAP_EVENTS_Callback callback,
+                               void* user_data, cJSON* options);
+
+/**
+ * @brief Subscribe to an event with its own typed view callback.
+ *
+ * As ACAP_EVENTS_Subscribe_With(), but events are delivered as an ACAP_Event view.
+ */
+int ACAP_EVENTS_Subscribe_View(cJSON* eventDeclaration, ACAP_EVENTS_View_Callback callback,
+                               void* user_data, cJSON* options);
+
 /**
  * @brief Unsubscribe from an event.
  * @param id Subscription ID from ACAP_EVENTS_Subscribe, or 0 to unsubscribe all
@@ -466,6 +638,183 @@ int ACAP_EVENTS_Subscribe(cJSON* eventDeclaration, void* user_data);
  */
 int ACAP_EVENTS_Unsubscribe(int id);
 
+/**
+ * @brief Deliver subscribed events through a bounded queue.
+ *
+ * By default callbacks run directly in the axevent callback on the GLib
+ * main loop, so a slow callback delays all event delivery. With a queue,
+ * events are handed to a lock-free ring and the callbacks run on worker
+ * threads (workers > 0) or in batches from a main loop idle source
+ * (workers == 0). With more than one worker, callbacks run concurrently
+ * and must be thread-safe. Counters are reported in the "eventQueue"
+ * status group.
+ *
+ * Call from the main loop thread, preferably before subscribing.
+ * Reconfiguring delivers the events already queued first.
+ *
+ * @param workers Worker threads (max 16), 0 for the main loop, -1 for direct delivery
+ * @param capacity Queue slots, rounded up to a power of two
+ * @param overflow What to do when the queue is full. ACAP_EVENTS_BLOCK
+ *        requires workers and falls back to drop-oldest without them.
+ * @return 1 on success, 0 on failure (delivery stays direct)
+ *
+ * Example:
+ * @code
+ * ACAP_EVENTS_SetDispatch(2, 256, ACAP_EVENTS_DROP_OLDEST);
+ * @endcode
+ */
+int ACAP_EVENTS_SetDispatch(int workers, int capacity, ACAP_EVENTS_Overflow overflow);
+
+/**
+ * @brief Set the typed event callback for subscribed events.
+ *
+ * Events are delivered as an ACAP_Event view that reads the SDK event in
+ * place, so no cJSON tree is built unless the callback asks for one.
+ * Can be combined with ACAP_EVENTS_SetCallback(); both are then called.
+ *
+ * @param callback Function to call when subscribed events occur
+ * @return 1 on success
+ *
+ * Example:
+ * @code
+ * void My_Event_View(const ACAP_Event event, void* user_data) {
+ *     if (ACAP_EVENT_Type(event, "active") == ACAP_EVENT_BOOL)
+ *         LOG("%s %d\n", ACAP_EVENT_Topic(event), ACAP_EVENT_Bool(event, "active"));
+ * }
+ * ACAP_EVENTS_SetViewCallback(My_Event_View);
+ * @endcode
+ */
+int ACAP_EVENTS_SetViewCallback(ACAP_EVENTS_View_Callback callback);
+
+/**
+ * @brief Record subscribed events to a file.
+ *
+ * Every event received on a subscription is appended together with the
+ * subscription "name" and its arrival time, before dedupe and rate
+ * limiting. Appending to an existing file continues the recording; its time
+ * line resumes at the last recorded event, so the pause between the two
+ * recordings is not replayed. An incomplete last record, left by a crash or
+ * a full disk, is truncated first.
+ *
+ * @param path Absolute path (e.g. on the SD card) or a path relative to the
+ *        application directory such as "localdata/events.rec". NULL stops recording.
+ * @return 1 on success, 0 if the file could not be opened or is not a recording
+ */
+int ACAP_EVENTS_Record(const char* path);
+
+/**
+ * @brief Replay a recording made with ACAP_EVENTS_Record().
+ *
+ * Events are rebuilt and passed through the normal delivery path (gate,
+ * dispatch queue, callbacks). An event goes to the subscription with the
+ * same name, or to the global callbacks if there is none, so a recording
+ * can be replayed without any live subscription.
+ *
+ * Blocks the calling thread until done, waiting between events with
+ * g_usleep(). Called from the main loop, nothing else on it runs meanwhile:
+ * debounceMs/coalesce timers and the idle dispatch queue fire only after
+ * replay returns. When those matter, call it from a worker thread and do not
+ * subscribe or unsubscribe until it returns.
+ *
+ * @param path Recording file, absolute or relative to the application directory
+ * @param speed 1.0 for the recorded timing, 10.0 for ten times faster,
+ *        0 for as fast as possible
+ * @return Number of events replayed
+ *
+ * Example:
+ * @code
+ * ACAP_EVENTS_Record("localdata/events.rec");   // on the camera
+ * ...
+ * ACAP_EVENTS_Replay("localdata/events.rec", 0); // regression run
+ * @endcode
+ */
+int ACAP_EVENTS_Replay(const char* path, double speed);
+
+/**
+ * @brief Size the recent event history served by GET /events.
+ *
+ * Every event delivered to the callbacks is also kept in a fixed ring of
+ * compact records (topic and properties, up to about 500 bytes each).
+ * The history is on with 256 records by default. Safe to call at any
+ * time; the records kept so far are discarded.
+ *
+ * GET /events?since=<sequence>&topic=<prefix> returns the records newer
+ * than "since" whose topic starts with "prefix", oldest first, together
+ * with the latest sequence number to pass as "since" next time.
+ *
+ * @param capacity Records to keep, rounded up to a power of two; 0 disables
+ * @return 1 on success, 0 on failure (history disabled)
+ */
+int ACAP_EVENTS_SetHistory(int capacity);
+
+/**
+ * @brief Full topic path of an event, e.g. "tns1/Device/tnsaxis/IO/VirtualInput".
+ *
+ * Same string as the "event" property of the cJSON representation.
+ * CameraApplicationPlatform is reported as "acap".
+ */
+const char* ACAP_EVENT_Topic(const ACAP_Event event);
+
+/**
+ * @brief One topic level of an event.
+ * @param level 0..5
+ * @return The topic value, or NULL if the event has no such level
+ */
+const char* ACAP_EVENT_Topic_Level(const ACAP_Event event, int level);
+
+/**
+ * @brief Number of properties in an event (topic levels not included).
+ */
+int ACAP_EVENT_Count(const ACAP_Event event);
+
+/**
+ * @brief Name of the property at index 0..ACAP_EVENT_Count()-1, or NULL.
+ */
+const char* ACAP_EVENT_Name(const ACAP_Event event, int index);
+
+/**
+ * @brief Type of a property, ACAP_EVENT_NONE if the event does not have it.
+ */
+ACAP_EVENT_Value_Type ACAP_EVENT_Type(const ACAP_Event event, const char* name);
+
+/**
+ * @brief Typed property getters.
+ *
+ * Return 0 / 0.0 / NULL when the property is missing. Numeric getters
+ * convert between int, bool and double; ACAP_EVENT_String only returns
+ * string values.
+ */
+int ACAP_EVENT_Bool(const ACAP_Event event, const char* name);
+int ACAP_EVENT_Int(const ACAP_Event event, const char* name);
+double ACAP_EVENT_Double(const ACAP_Event event, const char* name);
+const char* ACAP_EVENT_String(const ACAP_Event event, const char* name);
+
+/**
+ * @brief Convert an event view to cJSON.
+ * @return New object with every property plus "event" (the topic path).
+ *         Caller must free with cJSON_Delete().
+ */
+cJSON* ACAP_EVENT_JSON(const ACAP_Event event);
+
+/**
+ * @brief On/off state of a device event.
+ *
+ * Looks for the property that carries the state ("active", "state",
+ * "LogicalState", "Detected", ...). The property found is remembered per
+ * topic, so later events on the same topic need a single lookup.
+ * Booleans and numbers count as on when nonzero, text when "1" or "true".
+ *
+ * @return 1 on, 0 off, -1 if the event has no state property
+ */
+int ACAP_EVENT_State(const ACAP_Event event);
+
+/**
+ * @brief Same as ACAP_EVENT_State() for the cJSON event passed to an
+ *        ACAP_EVENTS_Callback (uses its "event" topic).
+ * @return 1 on, 0 off, -1 if the event has no state property
+ */
+int ACAP_EVENTS_Event_State(cJSON* event);
+
 /*=====================================================
  * FILE OPERATIONS
  *=====================================================*/
@@ -574,11 +923,25 @@ int ACAP_DEVICE_Prop_Int(const char* name);
 
 /**
  * @brief Get a device property as a cJSON object.
+ *
+ * "resolutions" and "location" are loaded on first access; a caller
+ * arriving while another thread loads them waits for that result.
  * @param name Property name (e.g., "location", "resolutions")
  * @return cJSON object (internally managed, do NOT delete), or NULL
  */
 cJSON* ACAP_DEVICE_JSON(const char* name);
 
+/**
+ * @brief Reload a lazily loaded device property from the device.
+ *
+ * The object previously returned by ACAP_DEVICE_JSON() keeps its address,
+ * but its members are replaced. Pointers to members taken before the
+ * refresh are freed; look them up again afterwards.
+ * @param name "resolutions" or "location"
+ * @return 1 on success, 0 if the property cannot be refreshed
+ */
+int ACAP_DEVICE_Refresh(const char* name);
+
 /**
  * @brief Get seconds elapsed since midnight (local time).
  * @return Seconds since midnight (0-86399)
@@ -0,0 +1,452 @@
+/*
+ * cJSON micro-benchmarks for the payloads the templates handle.
+ *
+ * Every fixture is parsed, printed, duplicated and searched, and each
+ * operation reports ns/op and allocs/op (malloc/calloc/realloc calls,
+ * counted through the linker's --wrap). Results are written to stdout as
+ * JSON so runs against different wrapper versions can be diffed; progress
+ * goes to stderr.
+ *
+ *   ./bench [-t seconds] [-f fixture] [-i]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include "cJSON.h"
+
+#ifndef BENCH_SETTINGS_DIR
+#define BENCH_SETTINGS_DIR "../base/app/settings"
+#endif
+#ifndef BENCH_FIXTURE_DIR
+#define BENCH_FIXTURE_DIR "fixtures"
+#endif
+#ifndef BENCH_CJSON_DIR
+#define BENCH_CJSON_DIR "../base/app"
+#endif
+
+/*-----------------------------------------------------
+ * Allocation counting
+ *-----------------------------------------------------*/
+
+static unsigned long long alloc_count = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    alloc_count++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    alloc_count++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    alloc_count++;
+    return __real_realloc(ptr, size);
+}
+
+/*-----------------------------------------------------
+ * Fixtures
+ *-----------------------------------------------------*/
+
+typedef struct {
+    const char* name;
+    const char* source;     /* file it was read from, or "generated" */
+    const char* select;     /* path for cJSON_ParseSelect, NULL to skip */
+    char* text;
+    size_t length;
+    unsigned char* cbor;
+    size_t cbor_length;
+    cJSON* tree;
+} fixture_t;
+
+static char* read_file(const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (text && fread(text, 1, (size_t)size, file) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    fclose(file);
+    if (!text)
+        return NULL;
+    text[size] = '\0';
+    *length = (size_t)size;
+    return text;
+}
+
+/* Deterministic values so every run measures the same documents */
+static unsigned int rng_state = 12345;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (rng_state >> 8) & 0xffffff;
+}
+
+/* thermometry.cgi getAreaStatus response with 20 areas */
+static cJSON* generate_area_status(void) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "apiVersion", "1.0");
+    cJSON_AddStringToObject(root, "context", "thermometry");
+    cJSON_AddStringToObject(root, "method", "getAreaStatus");
+    cJSON* data = cJSON_AddObjectToObject(root, "data");
+    cJSON* list = cJSON_AddArrayToObject(data, "areaList");
+    for (int i = 0; i < 20; i++) {
+        double min = 18.0 + (rng() % 400) / 100.0;
+        double max = min + (rng() % 2000) / 100.0;
+        cJSON* area = cJSON_CreateObject();
+        cJSON_AddNumberToObject(area, "id", i + 1);
+        cJSON_AddBoolToObject(area, "enabled", 1);
+        cJSON_AddNumberToObject(area, "min", min);
+        cJSON_AddNumberToObject(area, "max", max);
+        cJSON_AddNumberToObject(area, "average", (min + max) / 2);
+        cJSON_AddBoolToObject(area, "triggered", max > 35.0);
+        cJSON_AddItemToArray(list, area);
+    }
+    return root;
+}
+
+/* sdcardcapture /images?list response with 10000 images, newest first */
+static cJSON* generate_image_list(void) {
+    cJSON* list = cJSON_CreateArray();
+    time_t t = 1792310400;  /* 2026-10-18 */
+    for (int i = 0; i < 10000; i++) {
+        struct tm tm;
+        char filename[32], timestamp[32];
+        gmtime_r(&t, &tm);
+        strftime(filename, sizeof(filename), "%Y%m%d_%H%M%S.jpg", &tm);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm);
+        cJSON* image = cJSON_CreateObject();
+        cJSON_AddStringToObject(image, "filename", filename);
+        cJSON_AddStringToObject(image, "timestamp", timestamp);
+        cJSON_AddNumberToObject(image, "size", 180000 + rng() % 120000);
+        cJSON_AddBoolToObject(image, "hasThumb", (i % 50) != 0);
+        cJSON_AddItemToArray(list, image);
+        t -= 60 + rng() % 600;
+    }
+    return list;
+}
+
+/* Mixed numbers for the shortest round-trip formatter: counters,
+ * sensor readings with one or two decimals, and arbitrary doubles */
+static cJSON* generate_numbers(void) {
+    cJSON* list = cJSON_CreateArray();
+    for (int i = 0; i < 4096; i++) {
+        double value;
+        switch (i % 3) {
+            case 0:  value = rng() % 100000; break;
+            case 1:  value = (int)(rng() % 10000 - 2000) / 100.0; break;
+            default: value = (rng() / 16777216.0) * pow(10.0, (int)(rng() % 12) - 6); break;
+        }
+        cJSON_AddItemToArray(list, cJSON_CreateNumber(value));
+    }
+    return list;
+}
+
+static int fixture_from_file(fixture_t* f, const char* name, const char* dir, const char* file, const char* select) {
+    static char paths[8][512];
+    static int path_count = 0;
+    char* path = paths[path_count++ % 8];
+    snprintf(path, sizeof(paths[0]), "%s/%s", dir, file);
+    f->name = name;
+    f->source = path;
+    f->select = select;
+    f->text = read_file(path, &f->length);
+    if (!f->text) {
+        fprintf(stderr, "bench: cannot read %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+static int fixture_generated(fixture_t* f, const char* name, cJSON* tree, const char* select) {
+    f->name = name;
+    f->source = "generated";
+    f->select = select;
+    f->text = cJSON_PrintUnformatted(tree);
+    cJSON_Delete(tree);
+    if (!f->text)
+        return 0;
+    f->length = strlen(f->text);
+    return 1;
+}
+
+/*-----------------------------------------------------
+ * Operations
+ *-----------------------------------------------------*/
+
+typedef struct {
+    const cJSON* object;
+    const char* key;
+} lookup_t;
+
+static lookup_t* lookups = NULL;
+static size_t lookup_count = 0;
+static size_t lookup_capacity = 0;
+
+/* Every (object, key) pair in the tree, looked up by name */
+static void collect_lookups(const cJSON* item) {
+    const cJSON* child;
+    cJSON_ArrayForEach(child, item) {
+        if (cJSON_IsObject(item) && child->string) {
+            if (lookup_count == lookup_capacity) {
+                lookup_capacity = lookup_capacity ? lookup_capacity * 2 : 256;
+                lookups = realloc(lookups, lookup_capacity * sizeof(lookup_t));
+            }
+            lookups[lookup_count].object = item;
+            lookups[lookup_count].key = child->string;
+            lookup_count++;
+        }
+        collect_lookups(child);
+    }
+}
+
+static volatile size_t sink;
+
+static int op_parse(fixture_t* f) {
+    cJSON* tree = cJSON_Parse(f->text);
+    if (!tree)
+        return 0;
+    cJSON_Delete(tree);
+    return 1;
+}
+
+static int op_parse_arena(fixture_t* f) {
+    cJSON_Arena* arena = cJSON_ArenaBegin(f->length * 4 > 4096 ? f->length * 4 : 4096);
+    cJSON* tree = cJSON_Parse(f->text);
+    cJSON_ArenaEnd(arena);
+    return tree != NULL;
+}
+
+static int op_parse_select(fixture_t* f) {
+    const char* paths[] = { f->select };
+    cJSON* tree = cJSON_ParseSelect(f->text, paths, 1);
+    if (!tree)
+        return 0;
+    cJSON_Delete(tree);
+    return 1;
+}
+
+static int op_print(fixture_t* f) {
+    char* text = cJSON_PrintUnformatted(f->tree);
+    if (!text)
+        return 0;
+    sink += text[0];
+    free(text);
+    return 1;
+}
+
+static int op_print_formatted(fixture_t* f) {
+    char* text = cJSON_Print(f->tree);
+    if (!text)
+        return 0;
+    sink += text[0];
+    free(text);
+    return 1;
+}
+
+static int op_print_reuse(fixture_t* f) {
+    size_t length = 0;
+    const char* text = cJSON_PrintThreadBuffer(f->tree, 0, &length);
+    if (!text)
+        return 0;
+    sink += length;
+    return 1;
+}
+
+static int op_cbor_encode(fixture_t* f) {
+    size_t length = 0;
+    const unsigned char* data = cJSON_PrintThreadBufferCBOR(f->tree, &length);
+    if (!data)
+        return 0;
+    sink += length;
+    return 1;
+}
+
+static int op_cbor_decode(fixture_t* f) {
+    cJSON* tree = cJSON_ParseCBOR(f->cbor, f->cbor_length);
+    if (!tree)
+        return 0;
+    cJSON_Delete(tree);
+    return 1;
+}
+
+static int op_duplicate(fixture_t* f) {
+    cJSON* copy = cJSON_Duplicate(f->tree, 1);
+    if (!copy)
+        return 0;
+    cJSON_Delete(copy);
+    return 1;
+}
+
+static int op_lookup(fixture_t* f) {
+    (void)f;
+    for (size_t i = 0; i < lookup_count; i++)
+        sink += (size_t)cJSON_GetObjectItem(lookups[i].object, lookups[i].key);
+    return 1;
+}
+
+typedef struct {
+    const char* name;
+    int (*run)(fixture_t* f);
+    int per_lookup;     /* one call covers lookup_count operations */
+    int needs_select;
+} operation_t;
+
+static const operation_t operations[] = {
+    { "parse",           op_parse,           0, 0 },
+    { "parse_arena",     op_parse_arena,     0, 0 },
+    { "parse_select",    op_parse_select,    0, 1 },
+    { "print",           op_print,           0, 0 },
+    { "print_formatted", op_print_formatted, 0, 0 },
+    { "print_reuse",     op_print_reuse,     0, 0 },
+    { "cbor_encode",     op_cbor_encode,     0, 0 },
+    { "cbor_decode",     op_cbor_decode,     0, 0 },
+    { "duplicate",       op_duplicate,       0, 0 },
+    { "lookup",          op_lookup,          1, 0 },
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int first_result = 1;
+
+static int run_operation(fixture_t* f, const operation_t* op, double min_seconds) {
+    unsigned long long iterations = 1;
+    double elapsed = 0;
+    unsigned long long allocs = 0;
+
+    if (!op->run(f)) {  /* warm-up, also checks the operation works */
+        fprintf(stderr, "bench: %s/%s failed\n", f->name, op->name);
+        return 0;
+    }
+
+    for (;;) {
+        allocs = alloc_count;
+        double start = now_ns();
+        for (unsigned long long i = 0; i < iterations; i++)
+            op->run(f);
+        elapsed = now_ns() - start;
+        allocs = alloc_count - allocs;
+        if (elapsed >= min_seconds * 1e9 || iterations >= (1ULL << 40))
+            break;
+        /* aim past the target in one step once the first estimate is usable */
+        if (elapsed > 1e6)
+            iterations = (unsigned long long)(iterations * (min_seconds * 1.2e9 / elapsed)) + 1;
+        else
+            iterations *= 10;
+    }
+
+    double ops = (double)iterations;
+    if (op->per_lookup)
+        ops *= (double)lookup_count;
+    double ns_per_op = elapsed / ops;
+    double allocs_per_op = allocs / ops;
+    double mb_per_sec = op->per_lookup ? 0 : (f->length * (double)iterations) / (elapsed / 1e9) / 1e6;
+
+    printf("%s\n    {\"fixture\":\"%s\",\"op\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f",
+           first_result ? "" : ",", f->name, op->name, iterations, ns_per_op, allocs_per_op);
+    if (op->per_lookup)
+        printf(",\"lookups\":%zu}", lookup_count);
+    else
+        printf(",\"mb_per_sec\":%.1f}", mb_per_sec);
+    first_result = 0;
+
+    fprintf(stderr, "%-12s %-16s %12.1f ns/op %10.2f allocs/op\n", f->name, op->name, ns_per_op, allocs_per_op);
+    return 1;
+}
+
+/*-----------------------------------------------------
+ * Main
+ *-----------------------------------------------------*/
+
+int main(int argc, char** argv) {
+    double min_seconds = 0.25;
+    const char* only = NULL;
+    int intern = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:f:i")) != -1) {
+        switch (opt) {
+            case 't': min_seconds = atof(optarg); break;
+            case 'f': only = optarg; break;
+            case 'i': intern = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-t seconds] [-f fixture] [-i]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (intern)
+        cJSON_SetKeyInterning(cJSON_InternArena | cJSON_InternGlobal);
+
+    fixture_t fixtures[8];
+    int count = 0;
+    int ok = 1;
+    ok &= fixture_from_file(&fixtures[count++], "settings", BENCH_SETTINGS_DIR, "settings.json", NULL);
+    ok &= fixture_from_file(&fixtures[count++], "events", BENCH_SETTINGS_DIR, "events.json", NULL);
+    ok &= fixture_from_file(&fixtures[count++], "services", BENCH_FIXTURE_DIR, "services.json", NULL);
+    ok &= fixture_from_file(&fixtures[count++], "axevent", BENCH_FIXTURE_DIR, "axevent.json", NULL);
+    ok &= fixture_generated(&fixtures[count++], "areastatus", generate_area_status(), "data.areaList");
+    ok &= fixture_generated(&fixtures[count++], "images", generate_image_list(), NULL);
+    ok &= fixture_generated(&fixtures[count++], "numbers", generate_numbers(), NULL);
+    if (!ok)
+        return 1;
+
+    printf("{\n  \"cjson\":\"%s\",\n  \"source\":\"%s\",\n  \"min_seconds\":%g,\n  \"intern_keys\":%s,\n  \"fixtures\":[",
+           cJSON_Version(), BENCH_CJSON_DIR, min_seconds, intern ? "true" : "false");
+    for (int i = 0; i < count; i++) {
+        cJSON* tree = cJSON_Parse(fixtures[i].text);
+        fixtures[i].cbor = tree ? cJSON_PrintCBOR(tree, &fixtures[i].cbor_length) : NULL;
+        cJSON_Delete(tree);
+        printf("%s\n    {\"name\":\"%s\",\"source\":\"%s\",\"bytes\":%zu,\"cbor_bytes\":%zu}",
+               i ? "," : "", fixtures[i].name, fixtures[i].source, fixtures[i].length, fixtures[i].cbor_length);
+    }
+    printf("\n  ],\n  \"results\":[");
+
+    for (int i = 0; i < count; i++) {
+        fixture_t* f = &fixtures[i];
+        if (only && strcmp(only, f->name) != 0)
+            continue;
+        f->tree = cJSON_Parse(f->text);
+        if (!f->tree) {
+            fprintf(stderr, "bench: %s does not parse\n", f->source);
+            ok = 0;
+            continue;
+        }
+        lookup_count = 0;
+        collect_lookups(f->tree);
+        for (size_t j = 0; j < sizeof(operations) / sizeof(operations[0]); j++) {
+            if (operations[j].needs_select && !f->select)
+                continue;
+            if (operations[j].per_lookup && lookup_count == 0)
+                continue;
+            ok &= run_operation(f, &operations[j], min_seconds);
+        }
+        cJSON_Delete(f->tree);
+    }
+    printf("\n  ]\n}\n");
+
+    for (int i = 0; i < count; i++) {
+        free(fixtures[i].text);
+        cJSON_free(fixtures[i].cbor);
+    }
+    free(lookups);
+    cJSON_ReleaseThreadBuffers();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * Regression inputs for the CBOR decoder.
+ *
+ * Each case decodes a fixed, usually malformed, document with global key
+ * interning on (as ACAP does) and then parses again, so a shared key freed on
+ * an error path or a stack overflow shows up in the sanitizer build.
+ *
+ *   ./cbor_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+static int failures = 0;
+
+static void expect(const char* name, const unsigned char* data, size_t length, const char* expected) {
+    cJSON* json = cJSON_ParseCBOR(data, length);
+    char* printed = json ? cJSON_PrintUnformatted(json) : NULL;
+    const char* result = json ? (printed ? printed : "(print failed)") : "(error)";
+    if (strcmp(result, expected) != 0) {
+        printf("cbor_check: %s: got %s, expected %s\n", name, result, expected);
+        failures++;
+    }
+    free(printed);
+    cJSON_Delete(json);
+
+    /* Reuses the interned key "a"; touches freed memory if the decode above released it */
+    json = cJSON_Parse("{\"a\":1}");
+    cJSON_Delete(json);
+}
+
+int main(void) {
+    cJSON_SetKeyInterning(cJSON_InternGlobal);
+
+    /* {"a": [ truncated */
+    static const unsigned char array_cut[] = { 0xA1, 0x61, 'a', 0x81 };
+    expect("truncated array under interned key", array_cut, sizeof(array_cut), "(error)");
+    /* {"a": { truncated */
+    static const unsigned char map_cut[] = { 0xA1, 0x61, 'a', 0xA1 };
+    expect("truncated map under interned key", map_cut, sizeof(map_cut), "(error)");
+    /* {"a": [_ truncated */
+    static const unsigned char indefinite_cut[] = { 0xA1, 0x61, 'a', 0x9F, 0x01 };
+    expect("truncated indefinite array under interned key", indefinite_cut, sizeof(indefinite_cut), "(error)");
+    /* {"a": "x" truncated string */
+    static const unsigned char string_cut[] = { 0xA1, 0x61, 'a', 0x62, 'x' };
+    expect("truncated string under interned key", string_cut, sizeof(string_cut), "(error)");
+
+    /* 2 MB of tag 1 around the integer 1, and the same without the integer */
+    size_t tags = 2 * 1024 * 1024;
+    unsigned char* tagged = malloc(tags + 1);
+    if (!tagged) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    memset(tagged, 0xC1, tags);
+    tagged[tags] = 0x01;
+    expect("long tag run", tagged, tags + 1, "1");
+    expect("long tag run without item", tagged, tags, "(error)");
+    free(tagged);
+
+    if (failures)
+        return 1;
+    printf("cbor_check: all cases passed\n");
+    return 0;
+}
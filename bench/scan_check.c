@@ -0,0 +1,253 @@
+/*
+ * Differential check of the parser's vectorised scanning.
+ *
+ * Generates a fixed set of valid, broken and mutated documents, parses each
+ * one and prints the result (or the error offset) as one line per parse.
+ * `make check` builds this file twice, once with SSE2/NEON scanning and once
+ * with -DCJSON_NO_SIMD, and requires the two outputs to be identical.
+ * Length-limited parses use buffers of exactly that size with no terminator,
+ * so the sanitizer build also catches loads past the end.
+ *
+ *   ./scan_check [-n documents] [-s seed]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+#ifndef BENCH_FIXTURE_DIR
+#define BENCH_FIXTURE_DIR "fixtures"
+#endif
+
+/*-----------------------------------------------------
+ * Document generation
+ *-----------------------------------------------------*/
+
+static unsigned int rng_state = 12345;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (rng_state >> 8) & 0xffffff;
+}
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} text_t;
+
+static void put(text_t* t, const char* bytes, size_t length) {
+    if (t->length + length + 1 > t->capacity) {
+        t->capacity = (t->length + length + 1) * 2;
+        t->data = realloc(t->data, t->capacity);
+        if (!t->data) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    memcpy(t->data + t->length, bytes, length);
+    t->length += length;
+    t->data[t->length] = '\0';
+}
+
+static void put_str(text_t* t, const char* s) {
+    put(t, s, strlen(s));
+}
+
+/* Whitespace runs of every length around the 16-byte step, including the
+   control bytes the parser also skips */
+static void put_space(text_t* t) {
+    static const char space[] = { ' ', '\t', '\r', '\n', ' ', ' ', 0x01, 0x1f };
+    unsigned int length = rng() % 4 == 0 ? rng() % 40 : rng() % 3;
+    /* the two control bytes only in every eighth run */
+    size_t choices = rng() % 8 == 0 ? sizeof(space) : sizeof(space) - 2;
+    for (unsigned int i = 0; i < length; i++)
+        put(t, &space[rng() % choices], 1);
+}
+
+/* Strings of every length around the 16-byte step, with escapes and raw
+   UTF-8 at random offsets */
+static void put_string(text_t* t) {
+    static const char* pieces[] = {
+        "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9", "\\ud83d\\ude00", "\xc3\xa9", "\xe2\x82\xac", "'"
+    };
+    unsigned int length = rng() % 3 == 0 ? rng() % 70 : rng() % 20;
+    put_str(t, "\"");
+    for (unsigned int i = 0; i < length; i++) {
+        if (rng() % 12 == 0) {
+            put_str(t, pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))]);
+        } else {
+            char c = (char)('a' + rng() % 26);
+            put(t, &c, 1);
+        }
+    }
+    put_str(t, "\"");
+}
+
+static void put_value(text_t* t, int depth) {
+    char number[32];
+    unsigned int kind = depth > 4 ? rng() % 4 : rng() % 6;
+    put_space(t);
+    switch (kind) {
+        case 0: put_string(t); break;
+        case 1:
+            snprintf(number, sizeof(number), "%d.%u", (int)(rng() % 2000) - 1000, rng() % 100);
+            put_str(t, number);
+            break;
+        case 2: put_str(t, rng() % 2 ? "true" : "false"); break;
+        case 3: put_str(t, "null"); break;
+        case 4: {
+            unsigned int count = rng() % 6;
+            put_str(t, "[");
+            for (unsigned int i = 0; i < count; i++) {
+                if (i)
+                    put_str(t, ",");
+                put_value(t, depth + 1);
+            }
+            put_space(t);
+            put_str(t, "]");
+            break;
+        }
+        default: {
+            unsigned int count = rng() % 6;
+            put_str(t, "{");
+            for (unsigned int i = 0; i < count; i++) {
+                if (i)
+                    put_str(t, ",");
+                put_space(t);
+                put_string(t);
+                put_space(t);
+                put_str(t, ":");
+                put_value(t, depth + 1);
+            }
+            put_space(t);
+            put_str(t, "}");
+            break;
+        }
+    }
+    put_space(t);
+}
+
+/* Overwrite and cut bytes, favouring the ones the scanners look for */
+static void mutate(text_t* t) {
+    static const char special[] = { '"', '\\', ' ', '\n', 0x00, 0x1f, 0x20, 0x21, (char)0x80, (char)0xff, '{', ']' };
+    unsigned int edits = 1 + rng() % 4;
+    for (unsigned int i = 0; i < edits && t->length > 0; i++) {
+        size_t at = rng() % t->length;
+        switch (rng() % 3) {
+            case 0: t->data[at] = special[rng() % sizeof(special)]; break;
+            case 1: t->data[at] = (char)rng(); break;
+            default: t->length = at; t->data[at] = '\0'; break;
+        }
+    }
+}
+
+static char* read_file(const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (text && fread(text, 1, (size_t)size, file) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    fclose(file);
+    if (!text)
+        return NULL;
+    text[size] = '\0';
+    *length = (size_t)size;
+    return text;
+}
+
+/*-----------------------------------------------------
+ * Parsing
+ *-----------------------------------------------------*/
+
+static void report(unsigned long document, const char* mode, const char* start, const char* end, cJSON* json) {
+    if (json) {
+        char* printed = cJSON_PrintUnformatted(json);
+        printf("%lu %s ok %ld %s\n", document, mode, end ? (long)(end - start) : -1L, printed ? printed : "(print failed)");
+        free(printed);
+        cJSON_Delete(json);
+    } else {
+        printf("%lu %s error %ld\n", document, mode, end ? (long)(end - start) : -1L);
+    }
+}
+
+static void check(unsigned long document, const char* data, size_t length) {
+    /* Terminated copy through cJSON_Parse */
+    char* terminated = malloc(length + 1);
+    memcpy(terminated, data, length);
+    terminated[length] = '\0';
+    cJSON* json = cJSON_Parse(terminated);
+    report(document, "parse", terminated, json ? NULL : cJSON_GetErrorPtr(), json);
+    free(terminated);
+
+    /* Exact-size copy without terminator, also cut short by a few bytes */
+    for (size_t cut = 0; cut < 3 && cut <= length; cut++) {
+        size_t size = length - cut;
+        char* exact = malloc(size ? size : 1);
+        memcpy(exact, data, size);
+        const char* end = NULL;
+        json = cJSON_ParseWithLengthOpts(exact, size, &end, 0);
+        report(document, "length", exact, end, json);
+        free(exact);
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned long documents = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            documents = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            rng_state = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "usage: %s [-n documents] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    /* Fixtures as they are, then mutated */
+    static const char* fixtures[] = { "services.json", "axevent.json" };
+    text_t seeds[sizeof(fixtures) / sizeof(fixtures[0])];
+    size_t seed_count = 0;
+    for (size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", BENCH_FIXTURE_DIR, fixtures[i]);
+        size_t length = 0;
+        char* text = read_file(path, &length);
+        if (!text) {
+            fprintf(stderr, "scan_check: cannot read %s\n", path);
+            continue;
+        }
+        seeds[seed_count].data = text;
+        seeds[seed_count].length = length;
+        seeds[seed_count].capacity = length + 1;
+        check(seed_count, text, length);
+        seed_count++;
+    }
+
+    text_t doc = { NULL, 0, 0 };
+    for (unsigned long n = seed_count; n < documents; n++) {
+        doc.length = 0;
+        if (seed_count && rng() % 8 == 0) {
+            const text_t* seed = &seeds[rng() % seed_count];
+            put(&doc, seed->data, seed->length);
+        }
+        else
+            put_value(&doc, 0);
+        if (rng() % 2)
+            mutate(&doc);
+        check(n, doc.data, doc.length);
+    }
+
+    free(doc.data);
+    for (size_t i = 0; i < seed_count; i++)
+        free(seeds[i].data);
+    return 0;
+}
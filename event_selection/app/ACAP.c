@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdarg.h>
 #include <syslog.h>
 #include <string.h>
@@ -25,6 +26,7 @@
 #include <axsdk/axevent.h>
 #include <axsdk/axparameter.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include "fcgi_stdio.h"
 #include "ACAP.h"
 
@@ -52,11 +54,15 @@ struct ACAP_HTTP_Response_T {
     FCGX_Request*   fcgi;
 };
 
+#define ACAP_JSON_INDEX_THRESHOLD 16
+#define ACAP_JSON_INTERN_KEYS cJSON_InternArena
+
 /*-----------------------------------------------------
  * Global variables
  *-----------------------------------------------------*/
 static cJSON* app = NULL;
 static cJSON* status_container = NULL;
+static pthread_mutex_t device_lazy_mutex = PTHREAD_MUTEX_INITIALIZER;   /* Guards the "device" container */
 
 /*-----------------------------------------------------
  * Internal forward declarations
@@ -69,9 +75,11 @@ cJSON*  ACAP_EVENTS(void);
 int     ACAP_FILE_Init(void);
 cJSON*  ACAP_DEVICE(void);
 void    ACAP_VAPIX_Init(void);
+static char* vapix_perform(CURL* curl, const char* endpoint, const char* body);
 
 static void ACAP_ENDPOINT_settings(const ACAP_HTTP_Response response, const ACAP_HTTP_Request request);
 static void ACAP_ENDPOINT_app(const ACAP_HTTP_Response response, const ACAP_HTTP_Request request);
+static void ACAP_ENDPOINT_events(const ACAP_HTTP_Response response, const ACAP_HTTP_Request request);
 static char ACAP_package_name[ACAP_MAX_PACKAGE_NAME];
 static ACAP_Config_Update ACAP_UpdateCallback = NULL;
 cJSON* SplitString(const char* input, const char* delimiter);
@@ -84,6 +92,60 @@ const char* ACAP_Version(void) {
     return ACAP_VERSION;
 }
 
+/*-----------------------------------------------------
+ * Startup profiling — per-phase ACAP_Init durations
+ *-----------------------------------------------------*/
+#define BOOT_MAX_PHASES 12
+
+typedef struct {
+    const char* name;
+    double      ms;
+} boot_phase_t;
+
+static boot_phase_t    boot_phases[BOOT_MAX_PHASES];
+static int             boot_phase_count = 0;
+static struct timespec boot_start;
+static struct timespec boot_mark;
+
+static double boot_elapsed_ms(const struct timespec* from, const struct timespec* to) {
+    return (to->tv_sec - from->tv_sec) * 1000.0 + (to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+static void boot_begin(void) {
+    clock_gettime(CLOCK_MONOTONIC, &boot_start);
+    boot_mark = boot_start;
+    boot_phase_count = 0;
+}
+
+/* Close the current phase; its duration runs from the previous mark */
+static void boot_phase(const char* name) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (boot_phase_count < BOOT_MAX_PHASES) {
+        boot_phases[boot_phase_count].name = name;
+        boot_phases[boot_phase_count].ms = boot_elapsed_ms(&boot_mark, &now);
+        boot_phase_count++;
+    }
+    boot_mark = now;
+}
+
+/* Publish phases to the "boot" status group and log a single summary line */
+static void boot_publish(void) {
+    char summary[512];
+    size_t len = 0;
+    double total = boot_elapsed_ms(&boot_start, &boot_mark);
+
+    summary[0] = '\0';
+    for (int i = 0; i < boot_phase_count; i++) {
+        ACAP_STATUS_SetNumber("boot", boot_phases[i].name, round(boot_phases[i].ms * 10) / 10);
+        if (len < sizeof(summary))
+            len += snprintf(summary + len, sizeof(summary) - len, "%s%s %.1f",
+                            i ? ", " : "", boot_phases[i].name, boot_phases[i].ms);
+    }
+    ACAP_STATUS_SetNumber("boot", "total", round(total * 10) / 10);
+    LOG("ACAP_Init: %.1f ms (%s)\n", total, summary);
+}
+
 cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
     if (!package) {
         LOG_WARN("Invalid package name\n");
@@ -91,6 +153,13 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
     }
 
     LOG_TRACE("%s: Initializing ACAP for package %s\n", __func__, package);
+    boot_begin();
+
+    /* Hash-index objects such as app, status groups and event declarations once they grow */
+    cJSON_SetIndexThreshold(ACAP_JSON_INDEX_THRESHOLD);
+    /* Share repeated keys in arena-built responses (image lists, events, thermometry areas).
+       Not process-wide: keys of application trees stay plain strings and their type stays exact */
+    cJSON_SetKeyInterning(ACAP_JSON_INTERN_KEYS);
 
     strncpy(ACAP_package_name, package, ACAP_MAX_PACKAGE_NAME - 1);
     ACAP_package_name[ACAP_MAX_PACKAGE_NAME - 1] = '\0';
@@ -99,6 +168,7 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
         LOG_WARN("Failed to initialize file system\n");
         return NULL;
     }
+    boot_phase("file");
 
     ACAP_UpdateCallback = callback;
 
@@ -113,6 +183,7 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
     if (manifest) {
         cJSON_AddItemToObject(app, "manifest", manifest);
     }
+    boot_phase("manifest");
 
     /* Load and merge settings */
     cJSON* settings = ACAP_FILE_Read("settings/settings.json");
@@ -125,7 +196,7 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
         cJSON* prop = savedSettings->child;
         while (prop) {
             if (cJSON_GetObjectItem(settings, prop->string)) {
-                if (prop->type == cJSON_Object) {
+                if (cJSON_IsObject(prop)) {
                     cJSON* settingsProp = cJSON_GetObjectItem(settings, prop->string);
                     if (!cJSON_IsObject(settingsProp)) {
                         /* Default is null or non-object — replace entirely */
@@ -149,20 +220,26 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
     }
 
     cJSON_AddItemToObject(app, "settings", settings);
+    boot_phase("settings");
 
     /* Initialize subsystems */
     ACAP_VAPIX_Init();
+    boot_phase("vapix");
     cJSON* events = ACAP_EVENTS();
     if (events) {
         cJSON_Delete(events);
     }
+    boot_phase("events");
     ACAP_HTTP();
+    boot_phase("http");
 
     ACAP_Set_Config("status", ACAP_STATUS());
     ACAP_Set_Config("device", ACAP_DEVICE());
+    boot_phase("device");
 
     ACAP_HTTP_Node("app", ACAP_ENDPOINT_app);
     ACAP_HTTP_Node("settings", ACAP_ENDPOINT_settings);
+    ACAP_HTTP_Node("events", ACAP_ENDPOINT_events);
 
     /* Notify about initial settings */
     if (ACAP_UpdateCallback) {
@@ -172,6 +249,8 @@ cJSON* ACAP_Init(const char* package, ACAP_Config_Update callback) {
             setting = setting->next;
         }
     }
+    boot_phase("callbacks");
+    boot_publish();
 
     LOG_TRACE("%s: Initialization complete\n", __func__);
     return settings;
@@ -184,7 +263,13 @@ ACAP_ENDPOINT_app(const ACAP_HTTP_Response response, const ACAP_HTTP_Request req
         ACAP_HTTP_Respond_Error(response, 405, "Method Not Allowed - Use GET");
         return;
     }
+    /* Materialize lazily loaded device subtrees before serializing, and keep
+       a concurrent ACAP_DEVICE_Refresh() from replacing them mid-print */
+    ACAP_DEVICE_JSON("resolutions");
+    ACAP_DEVICE_JSON("location");
+    pthread_mutex_lock(&device_lazy_mutex);
     ACAP_HTTP_Respond_JSON(response, app);
+    pthread_mutex_unlock(&device_lazy_mutex);
 }
 
 static void
@@ -214,14 +299,18 @@ ACAP_ENDPOINT_settings(const ACAP_HTTP_Response response, const ACAP_HTTP_Reques
             return;
         }
 
+        cJSON_Arena* arena = cJSON_ArenaBegin(0);
         cJSON* params = cJSON_Parse(body);
         if (!params) {
+            cJSON_ArenaEnd(arena);
             ACAP_HTTP_Respond_Error(response, 400, "Invalid JSON data");
             return;
         }
 
         LOG_TRACE("%s: %s\n", __func__, body);
 
+        /* Only the parsed request is arena-backed; merged settings live on the heap */
+        cJSON_ArenaSuspend();
         cJSON* settings = cJSON_GetObjectItem(app, "settings");
         cJSON* param = params->child;
         while (param) {
@@ -232,8 +321,9 @@ ACAP_ENDPOINT_settings(const ACAP_HTTP_Response response, const ACAP_HTTP_Reques
             }
             param = param->next;
         }
+        cJSON_ArenaResume();
+        cJSON_ArenaEnd(arena);
 
-        cJSON_Delete(params);
         ACAP_FILE_Write("localdata/settings.json", settings);
         ACAP_HTTP_Respond_Text(response, "Settings updated successfully");
         return;
@@ -287,6 +377,7 @@ void* fastcgi_thread_func(void* arg) {
     while (http_thread_running) {
         ACAP_HTTP_Process();
     }
+    cJSON_ReleaseThreadBuffers();
     LOG_TRACE("%s: Exit\n", __func__);
     return NULL;
 }
@@ -612,6 +703,8 @@ cJSON* ACAP_HTTP_Request_JSON(const ACAP_HTTP_Request request, const char* param
         return NULL;
 
     const char* contentType = ACAP_HTTP_Get_Content_Type(request);
+    if (contentType && strcmp(contentType, "application/cbor") == 0)
+        return cJSON_ParseCBOR((const unsigned char*)body, ACAP_HTTP_Get_Body_Length(request));
     if (!contentType || strcmp(contentType, "application/json") != 0)
         return NULL;
 
@@ -672,21 +765,74 @@ int ACAP_HTTP_Respond_String(ACAP_HTTP_Response response, const char* fmt, ...)
     return FCGX_PutStr(buffer, written, response->fcgi->out) == written;
 }
 
+/* Quality the Accept list gives to one media type; 0 when it is absent or refused with q=0 */
+static double http_accept_quality(const char* accept, const char* type) {
+    size_t type_len = strlen(type);
+    const char* entry = accept;
+    while (entry && *entry) {
+        while (*entry == ' ' || *entry == '\t' || *entry == ',')
+            entry++;
+        const char* end = strchr(entry, ',');
+        if (!end)
+            end = entry + strlen(entry);
+        const char* name_end = entry;
+        while (name_end < end && *name_end != ';' && *name_end != ' ' && *name_end != '\t')
+            name_end++;
+        if ((size_t)(name_end - entry) == type_len && g_ascii_strncasecmp(entry, type, type_len) == 0) {
+            double quality = 1.0;
+            for (const char* p = name_end; p < end; p++) {
+                if (*p != ';')
+                    continue;
+                p++;
+                while (p < end && (*p == ' ' || *p == '\t'))
+                    p++;
+                if (end - p > 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=')
+                    quality = g_ascii_strtod(p + 2, NULL);
+            }
+            return quality > 0 ? quality : 0;
+        }
+        entry = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
+/* True when the client names application/cbor in its Accept header, with a nonzero
+   quality no lower than the one it gives application/json */
+static int http_accepts_cbor(ACAP_HTTP_Response response) {
+    if (!response->fcgi)
+        return 0;
+    const char* accept = FCGX_GetParam("HTTP_ACCEPT", response->fcgi->envp);
+    if (!accept)
+        return 0;
+    double cbor = http_accept_quality(accept, "application/cbor");
+    return cbor > 0 && cbor >= http_accept_quality(accept, "application/json");
+}
+
 int ACAP_HTTP_Respond_JSON(ACAP_HTTP_Response response, cJSON* object) {
     if (!response || !object)
         return 0;
 
-    char* jsonString = cJSON_PrintUnformatted(object);
+    if (http_accepts_cbor(response)) {
+        size_t cbor_len = 0;
+        const unsigned char* cbor = cJSON_PrintThreadBufferCBOR(object, &cbor_len);
+        if (!cbor)
+            return 0;
+        ACAP_HTTP_Respond_String(response,
+            "Content-Type: application/cbor\r\n"
+            "Content-Length: %zu\r\n"
+            "Cache-Control: no-cache\r\n\r\n", cbor_len);
+        return FCGX_PutStr((const char*)cbor, cbor_len, response->fcgi->out) == (int)cbor_len;
+    }
+
+    /* Rendered into the HTTP thread's reusable buffer; not freed here */
+    size_t json_len = 0;
+    const char* jsonString = cJSON_PrintThreadBuffer(object, 0, &json_len);
     if (!jsonString)
         return 0;
 
     ACAP_HTTP_Header_JSON(response);
 
-    size_t json_len = strlen(jsonString);
-    int result = FCGX_PutStr(jsonString, json_len, response->fcgi->out) == (int)json_len;
-
-    free(jsonString);
-    return result;
+    return FCGX_PutStr(jsonString, json_len, response->fcgi->out) == (int)json_len;
 }
 
 int ACAP_HTTP_Respond_Data(ACAP_HTTP_Response response, size_t count, const void* data) {
@@ -727,6 +873,7 @@ int ACAP_HTTP_Respond_Text(ACAP_HTTP_Response response, const char* message) {
  *=====================================================*/
 
 static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void events_status_refresh(void);
 
 static void ACAP_ENDPOINT_status(const ACAP_HTTP_Response response, const ACAP_HTTP_Request request) {
     const char* method = ACAP_HTTP_Get_Method(request);
@@ -735,6 +882,7 @@ static void ACAP_ENDPOINT_status(const ACAP_HTTP_Response response, const ACAP_H
         return;
     }
 
+    events_status_refresh();
     pthread_mutex_lock(&status_mutex);
     if (!status_container)
         status_container = cJSON_CreateObject();
@@ -750,7 +898,8 @@ cJSON* ACAP_STATUS(void) {
     return status_container;
 }
 
-cJSON* ACAP_STATUS_Group(const char* name) {
+/* Caller holds status_mutex */
+static cJSON* status_group_locked(const char* name) {
     if (!name || !status_container)
         return NULL;
 
@@ -766,23 +915,39 @@ cJSON* ACAP_STATUS_Group(const char* name) {
     return group;
 }
 
+cJSON* ACAP_STATUS_Group(const char* name) {
+    pthread_mutex_lock(&status_mutex);
+    cJSON* group = status_group_locked(name);
+    pthread_mutex_unlock(&status_mutex);
+    return group;
+}
+
 /* Internal helper: set a value in a status group (thread-safe) */
 static void status_set_item(const char* group, const char* name, cJSON* value) {
     if (!group || !name || !value) {
         cJSON_Delete(value);
         return;
     }
-    cJSON* groupObj = ACAP_STATUS_Group(group);
+    pthread_mutex_lock(&status_mutex);
+    cJSON* groupObj = status_group_locked(group);
     if (!groupObj) {
+        pthread_mutex_unlock(&status_mutex);
         cJSON_Delete(value);
         return;
     }
-    pthread_mutex_lock(&status_mutex);
     cJSON_DeleteItemFromObject(groupObj, name);
     cJSON_AddItemToObject(groupObj, name, value);
     pthread_mutex_unlock(&status_mutex);
 }
 
+/* Look up a status item under status_mutex; NULL when absent */
+static cJSON* status_get_item(const char* group, const char* name) {
+    pthread_mutex_lock(&status_mutex);
+    cJSON* item = cJSON_GetObjectItem(status_group_locked(group), name);
+    pthread_mutex_unlock(&status_mutex);
+    return item;
+}
+
 void ACAP_STATUS_SetBool(const char* group, const char* name, int state) {
     status_set_item(group, name, cJSON_CreateBool(state));
 }
@@ -810,37 +975,36 @@ void ACAP_STATUS_SetNull(const char* group, const char* name) {
  *-----------------------------------------------------*/
 
 int ACAP_STATUS_Bool(const char* group, const char* name) {
-    cJSON* groupObj = ACAP_STATUS_Group(group);
-    if (!groupObj) return 0;
-    cJSON* item = cJSON_GetObjectItem(groupObj, name);
-    return (item && item->type == cJSON_True) ? 1 : 0;
+    pthread_mutex_lock(&status_mutex);
+    cJSON* item = cJSON_GetObjectItem(status_group_locked(group), name);
+    int value = cJSON_IsTrue(item) ? 1 : 0;
+    pthread_mutex_unlock(&status_mutex);
+    return value;
 }
 
 int ACAP_STATUS_Int(const char* group, const char* name) {
-    cJSON* groupObj = ACAP_STATUS_Group(group);
-    if (!groupObj) return 0;
-    cJSON* item = cJSON_GetObjectItem(groupObj, name);
-    return (item && cJSON_IsNumber(item)) ? item->valueint : 0;
+    pthread_mutex_lock(&status_mutex);
+    cJSON* item = cJSON_GetObjectItem(status_group_locked(group), name);
+    int value = (item && cJSON_IsNumber(item)) ? item->valueint : 0;
+    pthread_mutex_unlock(&status_mutex);
+    return value;
 }
 
 double ACAP_STATUS_Double(const char* group, const char* name) {
-    cJSON* groupObj = ACAP_STATUS_Group(group);
-    if (!groupObj) return 0.0;
-    cJSON* item = cJSON_GetObjectItem(groupObj, name);
-    return (item && cJSON_IsNumber(item)) ? item->valuedouble : 0.0;
+    pthread_mutex_lock(&status_mutex);
+    cJSON* item = cJSON_GetObjectItem(status_group_locked(group), name);
+    double value = (item && cJSON_IsNumber(item)) ? item->valuedouble : 0.0;
+    pthread_mutex_unlock(&status_mutex);
+    return value;
 }
 
 char* ACAP_STATUS_String(const char* group, const char* name) {
-    cJSON* groupObj = ACAP_STATUS_Group(group);
-    if (!groupObj) return NULL;
-    cJSON* item = cJSON_GetObjectItem(groupObj, name);
+    cJSON* item = status_get_item(group, name);
     return (item && cJSON_IsString(item)) ? item->valuestring : NULL;
 }
 
 cJSON* ACAP_STATUS_Object(const char* group, const char* name) {
-    cJSON* groupObj = ACAP_STATUS_Group(group);
-    if (!groupObj) return NULL;
-    return cJSON_GetObjectItem(groupObj, name);
+    return status_get_item(group, name);
 }
 
 /*=====================================================
@@ -910,20 +1074,23 @@ double ACAP_DEVICE_Uptime(void) {
 
 const char* ACAP_DEVICE_Prop(const char* attribute) {
     if (!ACAP_DEVICE_Container) return NULL;
+    /* Top-level strings are only added during ACAP_DEVICE(), never replaced */
+    pthread_mutex_lock(&device_lazy_mutex);
     cJSON* item = cJSON_GetObjectItem(ACAP_DEVICE_Container, attribute);
-    return (item && cJSON_IsString(item)) ? item->valuestring : NULL;
+    const char* value = (item && cJSON_IsString(item)) ? item->valuestring : NULL;
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return value;
 }
 
 int ACAP_DEVICE_Prop_Int(const char* attribute) {
     if (!ACAP_DEVICE_Container) return 0;
+    pthread_mutex_lock(&device_lazy_mutex);
     cJSON* item = cJSON_GetObjectItem(ACAP_DEVICE_Container, attribute);
-    return (item && cJSON_IsNumber(item)) ? item->valueint : 0;
+    int value = (item && cJSON_IsNumber(item)) ? item->valueint : 0;
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return value;
 }
 
-cJSON* ACAP_DEVICE_JSON(const char* attribute) {
-    if (!ACAP_DEVICE_Container) return NULL;
-    return cJSON_GetObjectItem(ACAP_DEVICE_Container, attribute);
-}
 
 /*-----------------------------------------------------
  * Location helpers
@@ -949,8 +1116,8 @@ static char* ExtractValue(const char* xml, const char* tag) {
     return value;
 }
 
-static cJSON* GetLocationData(void) {
-    char* xmlResponse = ACAP_VAPIX_Get("geolocation/get.cgi");
+/* Parse a geolocation/get.cgi response (may be NULL). Takes ownership of xmlResponse. */
+static cJSON* ParseLocationData(char* xmlResponse) {
     cJSON* locationData = cJSON_CreateObject();
 
     if (xmlResponse) {
@@ -1039,29 +1206,15 @@ static int SetLocationData(cJSON* location) {
     return 0;
 }
 
-/*-----------------------------------------------------
- * ACAP_DEVICE() — build device information at startup
- *-----------------------------------------------------*/
-
-// Helper: read parameter via axparameter API (works on all firmware)
-static char* get_parameter_value(const char* param_name) {
-    if (!param_name) return NULL;
-    GError* error = NULL;
-    AXParameter* axparameter = ax_parameter_new(ACAP_package_name, &error);
-    if (!axparameter) {
-        if (error) {
-            LOG_WARN("%s: Failed to create parameter handle: %s\n", __func__, error->message);
-            g_error_free(error);
-        }
-        return NULL;
-    }
+// Helper: read parameter via axparameter API (works on all firmware).
+// The handle is shared across all lookups made while building device info.
+static char* get_parameter_value(AXParameter* axparameter, const char* param_name) {
+    if (!axparameter || !param_name) return NULL;
     gchar* value = NULL;
     if (!ax_parameter_get(axparameter, param_name, &value, 0)) {
         LOG_WARN("%s: Failed to get parameter %s\n", __func__, param_name);
-        ax_parameter_free(axparameter);
         return NULL;
     }
-    ax_parameter_free(axparameter);
     if (!value) return NULL;
     char* result = strdup(value);
     g_free(value);
@@ -1085,168 +1238,465 @@ static const device_prop_t device_props[] = {
     { NULL, NULL, NULL, NULL }
 };
 
-static void device_load_resolutions(cJSON* container) {
-    cJSON* resolutions = cJSON_CreateObject();
-    cJSON_AddItemToObject(container, "resolutions", resolutions);
+#define DEVICE_PROP_SERIAL   0
+#define DEVICE_PROP_FIRMWARE 4
+#define DEVICE_CACHE_FILE    "localdata/device.json"
+#define DEVICE_CACHE_VERSION 2
+
+/*-----------------------------------------------------
+ * Concurrent VAPIX probes
+ *
+ * Each probe runs on its own thread with a private curl handle so the
+ * fallback lookups do not serialize on the shared VAPIX handle.
+ *-----------------------------------------------------*/
+typedef struct {
+    const char* endpoint;
+    const char* body;       /* NULL for GET */
+    char*       response;   /* Owned by the caller after device_probe_run() */
+    pthread_t   thread;
+    int         started;
+} device_probe_t;
+
+static void* device_probe_thread(void* arg) {
+    device_probe_t* probe = (device_probe_t*)arg;
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        LOG_WARN("%s: Unable to create curl handle for %s\n", __func__, probe->endpoint);
+        return NULL;
+    }
+    probe->response = vapix_perform(curl, probe->endpoint, probe->body);
+    curl_easy_cleanup(curl);
+    return NULL;
+}
+
+static void device_probe_run(device_probe_t* probes, int count) {
+    if (count == 1) {
+        probes[0].response = NULL;
+        probes[0].started = 0;
+        device_probe_thread(&probes[0]);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        probes[i].response = NULL;
+        probes[i].started = pthread_create(&probes[i].thread, NULL, device_probe_thread, &probes[i]) == 0;
+        if (!probes[i].started) {
+            LOG_WARN("%s: Thread creation failed, probing %s inline\n", __func__, probes[i].endpoint);
+            device_probe_thread(&probes[i]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (probes[i].started)
+            pthread_join(probes[i].thread, NULL);
+    }
+}
+
+/* Extract the value from a "group.name=value" param.cgi response (caller must free) */
+static char* device_param_response_value(const char* response) {
+    if (!response) return NULL;
+    const char* value = strchr(response, '=');
+    if (!value) return NULL;
+    value++;
+    size_t len = strcspn(value, "\r\n");
+    char* result = malloc(len + 1);
+    if (!result) return NULL;
+    memcpy(result, value, len);
+    result[len] = '\0';
+    return result;
+}
+
+/*-----------------------------------------------------
+ * Lazy device subtrees — "resolutions" and "location"
+ *
+ * These are only built on first access through ACAP_DEVICE_JSON() (or when
+ * /app is served). Concurrent callers wait for the one doing the load.
+ * ACAP_DEVICE_Refresh() reloads the subtree into the same object, replacing
+ * its members. The container is only changed with device_lazy_mutex held,
+ * and every reader inside this file takes it too.
+ *-----------------------------------------------------*/
+typedef struct {
+    const char* name;
+    cJSON*      (*load)(int refresh);
+    cJSON*      value;
+    int         loading;
+    pthread_t   thread;
+    int         thread_started;
+} device_lazy_t;
+
+static pthread_cond_t  device_lazy_cond  = PTHREAD_COND_INITIALIZER;
+static char* device_resolution_list = NULL;   /* Raw "WxH,WxH,..." list from axparameter/VAPIX/cache */
+
+static char* device_read_resolution_list(void) {
+    char* list = NULL;
+    GError* error = NULL;
+    AXParameter* axparameter = ax_parameter_new(ACAP_package_name, &error);
+    if (axparameter) {
+        list = get_parameter_value(axparameter, "root.Properties.Image.Resolution");
+        ax_parameter_free(axparameter);
+    } else if (error) {
+        g_error_free(error);
+    }
+    if (list && !list[0]) {
+        free(list);
+        list = NULL;
+    }
+    if (!list) {
+        LOG("%s: axparameter resolutions failed, trying VAPIX\n", __func__);
+        char* response = ACAP_VAPIX_Get("param.cgi?action=list&group=root.Properties.Image.Resolution");
+        list = device_param_response_value(response);
+        free(response);
+    }
+    return list;
+}
+
+static cJSON* device_load_resolutions(int refresh) {
+    char* list = NULL;
+    pthread_mutex_lock(&device_lazy_mutex);
+    if (device_resolution_list && !refresh)
+        list = strdup(device_resolution_list);
+    pthread_mutex_unlock(&device_lazy_mutex);
+    if (!list)
+        list = device_read_resolution_list();
 
+    cJSON* resolutions = cJSON_CreateObject();
     cJSON* res169  = cJSON_AddArrayToObject(resolutions, "16:9");
     cJSON* res43   = cJSON_AddArrayToObject(resolutions, "4:3");
     cJSON* res11   = cJSON_AddArrayToObject(resolutions, "1:1");
     cJSON* res1610 = cJSON_AddArrayToObject(resolutions, "16:10");
-
-    // Try axparameter first
-    int detected = 0;
-    char* resValue = get_parameter_value("root.Properties.Image.Resolution");
-    if (resValue) {
-        cJSON* resList = SplitString(resValue, ",");
-        free(resValue);
-        if (resList && cJSON_GetArraySize(resList) > 0) {
-            detected = 1;
-            cJSON* res = resList->child;
-            while (res) {
-                cJSON* wh = SplitString(res->valuestring, "x");
-                if (wh && cJSON_GetArraySize(wh) == 2) {
-                    int w = atoi(cJSON_GetArrayItem(wh, 0)->valuestring);
-                    int h = atoi(cJSON_GetArrayItem(wh, 1)->valuestring);
-                    int aspect = (w * 100) / h;
-                    if (aspect == 177) cJSON_AddItemToArray(res169,  cJSON_CreateString(res->valuestring));
-                    if (aspect == 133) cJSON_AddItemToArray(res43,   cJSON_CreateString(res->valuestring));
-                    if (aspect == 160) cJSON_AddItemToArray(res1610, cJSON_CreateString(res->valuestring));
-                    if (aspect == 100) cJSON_AddItemToArray(res11,   cJSON_CreateString(res->valuestring));
-                }
-                if (wh) cJSON_Delete(wh);
-                res = res->next;
-            }
+    if (!list)
+        return resolutions;
+
+    const char* cursor = list;
+    while (*cursor) {
+        size_t len = strcspn(cursor, ",");
+        int w = 0, h = 0;
+        char res[32];
+        if (len > 0 && len < sizeof(res) && sscanf(cursor, "%dx%d", &w, &h) == 2 && h > 0) {
+            memcpy(res, cursor, len);
+            res[len] = '\0';
+            int aspect = (w * 100) / h;
+            if (aspect == 177) cJSON_AddItemToArray(res169,  cJSON_CreateString(res));
+            if (aspect == 133) cJSON_AddItemToArray(res43,   cJSON_CreateString(res));
+            if (aspect == 160) cJSON_AddItemToArray(res1610, cJSON_CreateString(res));
+            if (aspect == 100) cJSON_AddItemToArray(res11,   cJSON_CreateString(res));
         }
-        if (resList) cJSON_Delete(resList);
+        cursor += len;
+        if (*cursor == ',')
+            cursor++;
     }
 
-    // VAPIX fallback
-    if (!detected) {
-        LOG("%s: axparameter resolutions failed, trying VAPIX\n", __func__);
-        char* response = ACAP_VAPIX_Get("param.cgi?action=list&group=root.Properties.Image.Resolution");
-        if (!response) return;
+    pthread_mutex_lock(&device_lazy_mutex);
+    free(device_resolution_list);
+    device_resolution_list = list;
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return resolutions;
+}
 
-        cJSON* items = SplitString(response, "=");
-        free(response);
-        if (!items || cJSON_GetArraySize(items) != 2) {
-            if (items) cJSON_Delete(items);
-            return;
+static cJSON* device_load_location(int refresh) {
+    (void)refresh;
+    return ParseLocationData(ACAP_VAPIX_Get("geolocation/get.cgi"));
+}
+
+static device_lazy_t device_lazy[] = {
+    { "resolutions", device_load_resolutions, NULL, 0, 0, 0 },
+    { "location",    device_load_location,    NULL, 0, 0, 0 },
+    { NULL, NULL, NULL, 0, 0, 0 }
+};
+
+static device_lazy_t* device_lazy_find(const char* name) {
+    for (int i = 0; name && device_lazy[i].name; i++) {
+        if (strcmp(device_lazy[i].name, name) == 0)
+            return &device_lazy[i];
+    }
+    return NULL;
+}
+
+static cJSON* device_lazy_get(device_lazy_t* lazy, int refresh) {
+    pthread_mutex_lock(&device_lazy_mutex);
+    while (lazy->loading)
+        pthread_cond_wait(&device_lazy_cond, &device_lazy_mutex);
+    if (!ACAP_DEVICE_Container || (lazy->value && !refresh)) {
+        cJSON* value = lazy->value;
+        pthread_mutex_unlock(&device_lazy_mutex);
+        return value;
+    }
+    lazy->loading = 1;
+    pthread_mutex_unlock(&device_lazy_mutex);
+
+    cJSON* fresh = lazy->load(refresh);
+
+    pthread_mutex_lock(&device_lazy_mutex);
+    if (fresh && !lazy->value) {
+        lazy->value = fresh;
+        cJSON_AddItemToObject(ACAP_DEVICE_Container, lazy->name, fresh);
+    } else if (fresh) {
+        /* Move the reloaded properties into the existing object */
+        cJSON* item = fresh->child;
+        while (item) {
+            cJSON* next = item->next;
+            char* key = strdup(item->string);
+            cJSON_DetachItemViaPointer(fresh, item);
+            if (key && cJSON_GetObjectItem(lazy->value, key))
+                cJSON_ReplaceItemInObject(lazy->value, key, item);
+            else if (key)
+                cJSON_AddItemToObject(lazy->value, key, item);
+            else
+                cJSON_Delete(item);
+            free(key);
+            item = next;
         }
+        cJSON_Delete(fresh);
+    }
+    lazy->loading = 0;
+    pthread_cond_broadcast(&device_lazy_cond);
+    cJSON* value = lazy->value;
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return value;
+}
 
-        cJSON* resList = SplitString(cJSON_GetArrayItem(items, 1)->valuestring, ",");
-        cJSON_Delete(items);
-        if (!resList) return;
-
-        cJSON* res = resList->child;
-        while (res) {
-            cJSON* wh = SplitString(res->valuestring, "x");
-            if (wh && cJSON_GetArraySize(wh) == 2) {
-                int w = atoi(cJSON_GetArrayItem(wh, 0)->valuestring);
-                int h = atoi(cJSON_GetArrayItem(wh, 1)->valuestring);
-                int aspect = (w * 100) / h;
-                if (aspect == 177) cJSON_AddItemToArray(res169,  cJSON_CreateString(res->valuestring));
-                if (aspect == 133) cJSON_AddItemToArray(res43,   cJSON_CreateString(res->valuestring));
-                if (aspect == 160) cJSON_AddItemToArray(res1610, cJSON_CreateString(res->valuestring));
-                if (aspect == 100) cJSON_AddItemToArray(res11,   cJSON_CreateString(res->valuestring));
-            }
-            if (wh) cJSON_Delete(wh);
-            res = res->next;
+static void* device_lazy_prefetch_thread(void* arg) {
+    device_lazy_get((device_lazy_t*)arg, 0);
+    cJSON_ReleaseThreadBuffers();
+    return NULL;
+}
+
+/* Load a subtree on a background thread so ACAP_Init does not wait for it */
+static void device_lazy_prefetch(const char* name) {
+    device_lazy_t* lazy = device_lazy_find(name);
+    if (!lazy || lazy->thread_started)
+        return;
+    lazy->thread_started = pthread_create(&lazy->thread, NULL, device_lazy_prefetch_thread, lazy) == 0;
+    if (!lazy->thread_started)
+        LOG_WARN("%s: Unable to start background load of %s\n", __func__, name);
+}
+
+static void device_lazy_cleanup(void) {
+    for (int i = 0; device_lazy[i].name; i++) {
+        if (device_lazy[i].thread_started) {
+            pthread_join(device_lazy[i].thread, NULL);
+            device_lazy[i].thread_started = 0;
         }
-        cJSON_Delete(resList);
+        device_lazy[i].value = NULL;   /* Owned by ACAP_DEVICE_Container */
+    }
+    free(device_resolution_list);
+    device_resolution_list = NULL;
+}
+
+cJSON* ACAP_DEVICE_JSON(const char* attribute) {
+    if (!ACAP_DEVICE_Container) return NULL;
+    device_lazy_t* lazy = device_lazy_find(attribute);
+    if (lazy)
+        return device_lazy_get(lazy, 0);
+    pthread_mutex_lock(&device_lazy_mutex);
+    cJSON* item = cJSON_GetObjectItem(ACAP_DEVICE_Container, attribute);
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return item;
+}
+
+int ACAP_DEVICE_Refresh(const char* attribute) {
+    device_lazy_t* lazy = device_lazy_find(attribute);
+    if (!lazy || !ACAP_DEVICE_Container) {
+        LOG_WARN("%s: %s cannot be refreshed\n", __func__, attribute ? attribute : "(null)");
+        return 0;
+    }
+    return device_lazy_get(lazy, 1) != NULL;
+}
+
+/*-----------------------------------------------------
+ * Device cache — localdata/device.json
+ *
+ * Hardware properties do not change between boots unless the firmware
+ * is upgraded or the SD/flash is moved to another unit, so the probed
+ * result is stored keyed by serial and firmware version. IPv4 and
+ * location are user-configurable and always read live.
+ *-----------------------------------------------------*/
+static const char* device_cached_keys[] = { "model", "platform", "chip", "aspect", NULL };
+
+static int device_cache_load(cJSON* container, const char* serial, const char* firmware) {
+    if (!serial || !firmware)
+        return 0;
+    cJSON* cache = ACAP_FILE_Read(DEVICE_CACHE_FILE);
+    if (!cache)
+        return 0;
+
+    int valid = cJSON_GetNumberValue(cJSON_GetObjectItem(cache, "cacheVersion")) == DEVICE_CACHE_VERSION;
+    const char* cachedSerial   = cJSON_GetStringValue(cJSON_GetObjectItem(cache, "serial"));
+    const char* cachedFirmware = cJSON_GetStringValue(cJSON_GetObjectItem(cache, "firmware"));
+    const char* resolutionList = cJSON_GetStringValue(cJSON_GetObjectItem(cache, "resolutionList"));
+    if (!cachedSerial || strcmp(cachedSerial, serial) != 0 ||
+        !cachedFirmware || strcmp(cachedFirmware, firmware) != 0 || !resolutionList)
+        valid = 0;
+    for (int i = 0; valid && device_cached_keys[i]; i++) {
+        if (!cJSON_GetObjectItem(cache, device_cached_keys[i]))
+            valid = 0;
+    }
+    if (!valid) {
+        LOG("%s: Device cache is stale, probing device\n", __func__);
+        cJSON_Delete(cache);
+        return 0;
     }
+
+    cJSON_AddStringToObject(container, "serial", serial);
+    cJSON_AddStringToObject(container, "firmware", firmware);
+    for (int i = 0; device_cached_keys[i]; i++)
+        cJSON_AddItemToObject(container, device_cached_keys[i],
+                              cJSON_DetachItemFromObject(cache, device_cached_keys[i]));
+    device_resolution_list = strdup(resolutionList);
+    cJSON_Delete(cache);
+    return 1;
+}
+
+static void device_cache_save(cJSON* container) {
+    cJSON* cache = cJSON_CreateObject();
+    cJSON_AddNumberToObject(cache, "cacheVersion", DEVICE_CACHE_VERSION);
+    cJSON_AddStringToObject(cache, "serial", ACAP_DEVICE_Prop("serial"));
+    cJSON_AddStringToObject(cache, "firmware", ACAP_DEVICE_Prop("firmware"));
+    for (int i = 0; device_cached_keys[i]; i++)
+        cJSON_AddItemToObject(cache, device_cached_keys[i],
+                              cJSON_Duplicate(cJSON_GetObjectItem(container, device_cached_keys[i]), 1));
+    cJSON_AddStringToObject(cache, "resolutionList", device_resolution_list);
+    if (!ACAP_FILE_Write(DEVICE_CACHE_FILE, cache))
+        LOG_WARN("%s: Unable to store device cache\n", __func__);
+    cJSON_Delete(cache);
 }
 
+/*-----------------------------------------------------
+ * ACAP_DEVICE() — build device information at startup
+ *-----------------------------------------------------*/
+
 cJSON* ACAP_DEVICE(void) {
     ACAP_DEVICE_Container = cJSON_CreateObject();
-    cJSON* data = NULL;
-    cJSON* apiData = NULL;
-    char* response = NULL;
 
-    /* Device properties: try axparameter first, VAPIX fallback */
-    int need_vapix = 0;
+    GError* error = NULL;
+    AXParameter* axparameter = ax_parameter_new(ACAP_package_name, &error);
+    if (!axparameter && error) {
+        LOG_WARN("%s: Failed to create parameter handle: %s\n", __func__, error->message);
+        g_error_free(error);
+    }
+
     char* prop_values[5] = {NULL};
-    for (int i = 0; device_props[i].json_key; i++) {
-        prop_values[i] = get_parameter_value(device_props[i].param_name);
-        if (!prop_values[i]) need_vapix = 1;
+    prop_values[DEVICE_PROP_SERIAL]   = get_parameter_value(axparameter, device_props[DEVICE_PROP_SERIAL].param_name);
+    prop_values[DEVICE_PROP_FIRMWARE] = get_parameter_value(axparameter, device_props[DEVICE_PROP_FIRMWARE].param_name);
+    char* ipAddr = get_parameter_value(axparameter, "root.Network.eth0.IPAddress");
+
+    int cached = device_cache_load(ACAP_DEVICE_Container,
+                                   prop_values[DEVICE_PROP_SERIAL], prop_values[DEVICE_PROP_FIRMWARE]);
+
+    char* aspectValue = NULL;
+    char* resValue = NULL;
+    int need_vapix = 0;
+    if (!cached) {
+        for (int i = 0; device_props[i].json_key; i++) {
+            if (!prop_values[i])
+                prop_values[i] = get_parameter_value(axparameter, device_props[i].param_name);
+            if (!prop_values[i]) need_vapix = 1;
+        }
+        aspectValue = get_parameter_value(axparameter, "root.ImageSource.I0.Sensor.AspectRatio");
+        resValue = get_parameter_value(axparameter, "root.Properties.Image.Resolution");
+        if (resValue && !resValue[0]) {
+            free(resValue);
+            resValue = NULL;
+        }
     }
+    if (axparameter)
+        ax_parameter_free(axparameter);
 
+    /* Everything axparameter could not answer is fetched from VAPIX concurrently */
+    device_probe_t probes[4];
+    int probeCount = 0;
+    int basicProbe = -1, ipProbe = -1, aspectProbe = -1, resProbe = -1;
     if (need_vapix) {
         LOG("%s: axparameter incomplete, trying VAPIX basicdeviceinfo.cgi\n", __func__);
-        const char* basicInfo =
-            "{\"apiVersion\":\"1.0\",\"context\":\"ACAP\",\"method\":\"getAllProperties\"}";
-        response = ACAP_VAPIX_Post("basicdeviceinfo.cgi", basicInfo);
-        if (response) {
-            apiData = cJSON_Parse(response);
+        basicProbe = probeCount;
+        probes[probeCount++] = (device_probe_t){ "basicdeviceinfo.cgi",
+            "{\"apiVersion\":\"1.0\",\"context\":\"ACAP\",\"method\":\"getAllProperties\"}", NULL, 0, 0 };
+    }
+    if (!ipAddr) {
+        LOG("%s: axparameter IP failed, trying VAPIX\n", __func__);
+        ipProbe = probeCount;
+        probes[probeCount++] = (device_probe_t){ "param.cgi?action=list&group=root.Network.eth0.IPAddress", NULL, NULL, 0, 0 };
+    }
+    if (!cached && !aspectValue) {
+        LOG("%s: axparameter aspect failed, trying VAPIX\n", __func__);
+        aspectProbe = probeCount;
+        probes[probeCount++] = (device_probe_t){ "param.cgi?action=list&group=root.ImageSource.I0.Sensor.AspectRatio", NULL, NULL, 0, 0 };
+    }
+    if (!cached && !resValue) {
+        LOG("%s: axparameter resolutions failed, trying VAPIX\n", __func__);
+        resProbe = probeCount;
+        probes[probeCount++] = (device_probe_t){ "param.cgi?action=list&group=root.Properties.Image.Resolution", NULL, NULL, 0, 0 };
+    }
+
+    if (probeCount)
+        device_probe_run(probes, probeCount);
+
+    /* Device properties */
+    int complete = 1;
+    if (!cached) {
+        cJSON* apiData = NULL;
+        cJSON* data = NULL;
+        if (basicProbe >= 0 && probes[basicProbe].response) {
+            /* Only the device_props keys of propertyList are built */
+            char selectBuf[5][64];
+            const char* select[5];
+            int selectCount = 0;
+            for (int i = 0; device_props[i].json_key && selectCount < 5; i++) {
+                snprintf(selectBuf[selectCount], sizeof(selectBuf[0]), "data.propertyList.%s", device_props[i].api_key);
+                select[selectCount] = selectBuf[selectCount];
+                selectCount++;
+            }
+            apiData = cJSON_ParseSelect(probes[basicProbe].response, select, selectCount);
             if (apiData) {
                 data = cJSON_GetObjectItem(apiData, "data");
                 if (data) data = cJSON_GetObjectItem(data, "propertyList");
             }
         }
-    }
-
-    for (int i = 0; device_props[i].json_key; i++) {
-        if (prop_values[i]) {
-            cJSON_AddStringToObject(ACAP_DEVICE_Container, device_props[i].json_key, prop_values[i]);
-            free(prop_values[i]);
-        } else {
-            cJSON* item = data ? cJSON_GetObjectItem(data, device_props[i].api_key) : NULL;
-            cJSON_AddStringToObject(ACAP_DEVICE_Container, device_props[i].json_key,
-                (item && item->valuestring) ? item->valuestring : device_props[i].fallback);
+        for (int i = 0; device_props[i].json_key; i++) {
+            if (prop_values[i]) {
+                cJSON_AddStringToObject(ACAP_DEVICE_Container, device_props[i].json_key, prop_values[i]);
+            } else {
+                cJSON* item = data ? cJSON_GetObjectItem(data, device_props[i].api_key) : NULL;
+                if (!item || !item->valuestring)
+                    complete = 0;
+                cJSON_AddStringToObject(ACAP_DEVICE_Container, device_props[i].json_key,
+                    (item && item->valuestring) ? item->valuestring : device_props[i].fallback);
+            }
         }
-    }
+        if (apiData) cJSON_Delete(apiData);
+    }
+    for (int i = 0; device_props[i].json_key; i++)
+        free(prop_values[i]);
+
+    /* IP address */
+    if (!ipAddr && ipProbe >= 0)
+        ipAddr = device_param_response_value(probes[ipProbe].response);
+    cJSON_AddStringToObject(ACAP_DEVICE_Container, "IPv4", ipAddr ? ipAddr : "");
+    free(ipAddr);
+
+    if (!cached) {
+        /* Aspect ratio */
+        if (!aspectValue && aspectProbe >= 0)
+            aspectValue = device_param_response_value(probes[aspectProbe].response);
+        if (!aspectValue)
+            complete = 0;
+        cJSON_AddStringToObject(ACAP_DEVICE_Container, "aspect", aspectValue ? aspectValue : "16:9");
+        free(aspectValue);
 
-    if (apiData) cJSON_Delete(apiData);
-    if (response) free(response);
+        /* Raw resolution list — bucketed by aspect on first access */
+        if (!resValue && resProbe >= 0)
+            resValue = device_param_response_value(probes[resProbe].response);
+        if (!resValue)
+            complete = 0;
+        device_resolution_list = resValue;
 
-    /* IP address: axparameter first */
-    char* ipAddr = get_parameter_value("root.Network.eth0.IPAddress");
-    if (ipAddr) {
-        cJSON_AddStringToObject(ACAP_DEVICE_Container, "IPv4", ipAddr);
-        free(ipAddr);
-    } else {
-        LOG("%s: axparameter IP failed, trying VAPIX\n", __func__);
-        response = ACAP_VAPIX_Get("param.cgi?action=list&group=root.Network.eth0.IPAddress");
-        if (response) {
-            cJSON* items = SplitString(response, "=");
-            if (items && cJSON_GetArraySize(items) == 2)
-                cJSON_AddStringToObject(ACAP_DEVICE_Container, "IPv4", cJSON_GetArrayItem(items, 1)->valuestring);
-            else
-                cJSON_AddStringToObject(ACAP_DEVICE_Container, "IPv4", "");
-            if (items) cJSON_Delete(items);
-            free(response);
-        } else {
-            cJSON_AddStringToObject(ACAP_DEVICE_Container, "IPv4", "");
-        }
+        if (complete)
+            device_cache_save(ACAP_DEVICE_Container);
     }
 
-    /* Location */
-    cJSON_AddItemToObject(ACAP_DEVICE_Container, "location", GetLocationData());
-
-    /* Aspect ratio: axparameter first */
-    char* aspectValue = get_parameter_value("root.ImageSource.I0.Sensor.AspectRatio");
-    if (aspectValue) {
-        LOG("%s: axparameter returned aspect ratio: %s\n", __func__, aspectValue);
-        cJSON_AddStringToObject(ACAP_DEVICE_Container, "aspect", aspectValue);
-        free(aspectValue);
-    } else {
-        LOG("%s: axparameter aspect failed, trying VAPIX\n", __func__);
-        response = ACAP_VAPIX_Get("param.cgi?action=list&group=root.ImageSource.I0.Sensor.AspectRatio");
-        if (response) {
-            cJSON* items = SplitString(response, "=");
-            if (items && cJSON_GetArraySize(items) == 2)
-                cJSON_AddStringToObject(ACAP_DEVICE_Container, "aspect", cJSON_GetArrayItem(items, 1)->valuestring);
-            else
-                cJSON_AddStringToObject(ACAP_DEVICE_Container, "aspect", "16:9");
-            if (items) cJSON_Delete(items);
-            free(response);
-        } else {
-            cJSON_AddStringToObject(ACAP_DEVICE_Container, "aspect", "16:9");
-        }
-    }
+    for (int i = 0; i < probeCount; i++)
+        free(probes[i].response);
 
-    /* Resolutions */
-    device_load_resolutions(ACAP_DEVICE_Container);
+    /* Location is fetched in the background; readers block until it is available */
+    device_lazy_prefetch("location");
 
     return ACAP_DEVICE_Container;
 }
@@ -1255,33 +1705,43 @@ cJSON* ACAP_DEVICE(void) {
  * Time and System Information
  *-----------------------------------------------------*/
 
-double ACAP_DEVICE_Longitude(void) {
-    if (!ACAP_DEVICE_Container) return 0;
-    cJSON* location = cJSON_GetObjectItem(ACAP_DEVICE_Container, "location");
+/* A number from the location subtree, read under device_lazy_mutex like the other device accessors */
+static double device_location_number(const char* name) {
+    cJSON* location = ACAP_DEVICE_JSON("location");
     if (!location) return 0;
-    cJSON* lon = cJSON_GetObjectItem(location, "lon");
-    return lon ? lon->valuedouble : 0;
+    pthread_mutex_lock(&device_lazy_mutex);
+    cJSON* item = cJSON_GetObjectItem(location, name);
+    double value = item ? item->valuedouble : 0;
+    pthread_mutex_unlock(&device_lazy_mutex);
+    return value;
+}
+
+double ACAP_DEVICE_Longitude(void) {
+    return device_location_number("lon");
 }
 
 double ACAP_DEVICE_Latitude(void) {
-    if (!ACAP_DEVICE_Container) return 0;
-    cJSON* location = cJSON_GetObjectItem(ACAP_DEVICE_Container, "location");
-    if (!location) return 0;
-    cJSON* lat = cJSON_GetObjectItem(location, "lat");
-    return lat ? lat->valuedouble : 0;
+    return device_location_number("lat");
 }
 
 int ACAP_DEVICE_Set_Location(double lat, double lon) {
     LOG_TRACE("%s: %f %f\n", __func__, lat, lon);
-    if (!ACAP_DEVICE_Container) return 0;
-    cJSON* location = cJSON_GetObjectItem(ACAP_DEVICE_Container, "location");
+    cJSON* location = ACAP_DEVICE_JSON("location");
     if (!location) {
         LOG_WARN("%s: Missing location data\n", __func__);
         return 0;
     }
+    /* Updated under the lock; the VAPIX call works on a copy so readers are not held up */
+    pthread_mutex_lock(&device_lazy_mutex);
     cJSON_ReplaceItemInObject(location, "lat", cJSON_CreateNumber(lat));
     cJSON_ReplaceItemInObject(location, "lon", cJSON_CreateNumber(lon));
-    return SetLocationData(location);
+    cJSON* copy = cJSON_Duplicate(location, 1);
+    pthread_mutex_unlock(&device_lazy_mutex);
+    if (!copy)
+        return 0;
+    int success = SetLocationData(copy);
+    cJSON_Delete(copy);
+    return success;
 }
 
 int ACAP_DEVICE_Seconds_Since_Midnight(void) {
@@ -1453,18 +1913,18 @@ int ACAP_FILE_Write(const char* filepath, cJSON* object) {
         return 0;
     }
 
-    char* jsonString = cJSON_Print(object);
+    size_t length = 0;
+    const char* jsonString = cJSON_PrintThreadBuffer(object, 1, &length);
     if (!jsonString) {
         LOG_WARN("JSON serialization error for %s\n", filepath);
         fclose(file);
         return 0;
     }
 
-    int result = fputs(jsonString, file);
-    free(jsonString);
+    size_t written = fwrite(jsonString, 1, length, file);
     fclose(file);
 
-    if (result < 0) {
+    if (written != length) {
         LOG_WARN("Could not save data to %s\n", filepath);
         return 0;
     }
@@ -1507,8 +1967,10 @@ int ACAP_FILE_Exists(const char* filepath) {
 
 static ACAP_EVENTS_Callback EVENT_USER_CALLBACK = NULL;
 static void ACAP_EVENTS_Main_Callback(guint subscription, AXEvent* event, gpointer user_data);
-static cJSON* ACAP_EVENTS_SUBSCRIPTIONS = NULL;
-static cJSON* ACAP_EVENTS_DECLARATIONS = NULL;
+static GHashTable* ACAP_EVENTS_SUBSCRIBERS = NULL;     /* id -> T_Subscription* */
+static void subscription_close(gpointer data);
+static GHashTable* ACAP_EVENTS_DECLARATIONS = NULL;     /* id -> T_Declaration* */
+static void declaration_free(gpointer data);
 static AXEventHandler* ACAP_EVENTS_HANDLER = NULL;
 
 static char ACAP_EVENTS_PACKAGE[64];
@@ -1539,6 +2001,12 @@ typedef struct S_ValueElement {
     AXEventValueType value_type;
 } T_ValueElement;
 
+#define EVENT_STATS_INTERVAL 5      /* Seconds between event statistics samples */
+#define HISTORY_DEFAULT_CAPACITY 256 /* Recent events kept for GET /events */
+static int history_configured = 0;  /* ACAP_EVENTS_SetHistory() was called */
+static gboolean events_stats_sample(gpointer data);
+static guint events_stats_timer = 0;
+
 cJSON* ACAP_EVENTS(void) {
     LOG_TRACE("%s:\n", __func__);
 
@@ -1559,9 +2027,12 @@ cJSON* ACAP_EVENTS(void) {
     snprintf(ACAP_EVENTS_APPNAME, sizeof(ACAP_EVENTS_APPNAME), "%s", friendlyName->valuestring);
     LOG_TRACE("%s: %s %s\n", __func__, ACAP_EVENTS_PACKAGE, ACAP_EVENTS_APPNAME);
 
-    ACAP_EVENTS_SUBSCRIPTIONS = cJSON_CreateArray();
-    ACAP_EVENTS_DECLARATIONS = cJSON_CreateObject();
+    ACAP_EVENTS_DECLARATIONS = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, declaration_free);
+    ACAP_EVENTS_SUBSCRIBERS = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, subscription_close);
     ACAP_EVENTS_HANDLER = ax_event_handler_new();
+    events_stats_timer = g_timeout_add_seconds(EVENT_STATS_INTERVAL, events_stats_sample, NULL);
+    if (!history_configured)
+        ACAP_EVENTS_SetHistory(HISTORY_DEFAULT_CAPACITY);
 
     cJSON* events = ACAP_FILE_Read("settings/events.json");
     if (!events)
@@ -1580,99 +2051,2167 @@ int ACAP_EVENTS_SetCallback(ACAP_EVENTS_Callback callback) {
     return 1;
 }
 
-cJSON* ACAP_EVENTS_Parse(AXEvent* axEvent) {
-    LOG_TRACE("%s: Entry\n", __func__);
+/*-----------------------------------------------------
+ * Typed event view
+ *
+ * Reads the SDK key-value set in place: topic levels and property
+ * names/values are pointers into the AXEvent, so a view costs one pass
+ * over the hash table and no allocation unless the topic path is longer
+ * than the inline buffer. cJSON is only built when someone asks for it.
+ *-----------------------------------------------------*/
+#define ACAP_EVENT_MAX_TOPICS      6
+#define ACAP_EVENT_MAX_PROPERTIES  32
+#define ACAP_EVENT_TOPIC_LENGTH    256
 
-    const T_ValueSet* set = (T_ValueSet*)ax_event_get_key_value_set(axEvent);
-    cJSON* object = cJSON_CreateObject();
+typedef struct {
+    const char* name;
+    const T_ValueElement* value;
+} T_EventProperty;
+
+struct ACAP_Event_T {
+    const T_ValueSet* set;
+    const char* topics[ACAP_EVENT_MAX_TOPICS];
+    const char* topic;
+    char* topicHeap;
+    int count;
+    int overflow;       /* More properties than fit in properties[] */
+    T_EventProperty properties[ACAP_EVENT_MAX_PROPERTIES];
+    char topicBuffer[ACAP_EVENT_TOPIC_LENGTH];
+};
+
+static ACAP_EVENTS_View_Callback EVENT_VIEW_CALLBACK = NULL;
+
+/* "topic0".."topic5" -> 0..5, any other key -> -1 */
+static inline int event_topic_level(const char* key) {
+    if (key[0] != 't' || strncmp(key, "topic", 5) != 0)
+        return -1;
+    unsigned level = (unsigned)(unsigned char)key[5] - '0';
+    return (level < ACAP_EVENT_MAX_TOPICS && key[6] == '\0') ? (int)level : -1;
+}
 
-    char topics[6][32];
-    for (int i = 0; i < 6; i++)
-        topics[i][0] = '\0';
+static void event_view_join_topic(struct ACAP_Event_T* view) {
+    size_t lengths[ACAP_EVENT_MAX_TOPICS];
+    size_t total = 0;
+    for (int i = 0; i < ACAP_EVENT_MAX_TOPICS; i++) {
+        lengths[i] = view->topics[i] ? strlen(view->topics[i]) : 0;
+        total += lengths[i] + 1;
+    }
+
+    char* path = view->topicBuffer;
+    if (total > sizeof(view->topicBuffer))
+        path = view->topicHeap = g_malloc(total);
+
+    /* Level 0 always leads, deeper levels are appended only when present */
+    size_t at = lengths[0];
+    memcpy(path, view->topics[0] ? view->topics[0] : "", lengths[0]);
+    for (int i = 1; i < ACAP_EVENT_MAX_TOPICS; i++) {
+        if (!lengths[i])
+            continue;
+        path[at++] = '/';
+        memcpy(path + at, view->topics[i], lengths[i]);
+        at += lengths[i];
+    }
+    path[at] = '\0';
+    view->topic = path;
+}
+
+static int event_view_init(struct ACAP_Event_T* view, AXEvent* axEvent) {
+    memset(view, 0, offsetof(struct ACAP_Event_T, properties));
+    view->set = (const T_ValueSet*)ax_event_get_key_value_set(axEvent);
+    if (!view->set || !view->set->key_values)
+        return 0;
 
     GHashTableIter iter;
     T_KeyPair* nskp;
     T_ValueElement* value_element;
-    g_hash_table_iter_init(&iter, set->key_values);
-
+    g_hash_table_iter_init(&iter, view->set->key_values);
     while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value_element)) {
-        /* Check if this is a topic key (topic0..topic5) */
-        int isTopic = 0;
-        for (int i = 0; i < 6; i++) {
-            char key[8];
-            snprintf(key, sizeof(key), "topic%d", i);
-            if (strcmp(nskp->key, key) == 0) {
-                if (i == 0 && strcmp((char*)value_element->str_value, "CameraApplicationPlatform") == 0)
-                    snprintf(topics[0], sizeof(topics[0]), "acap");
-                else
-                    snprintf(topics[i], sizeof(topics[i]), "%s", value_element->str_value);
-                isTopic = 1;
-                break;
-            }
-        }
-
-        if (!isTopic && value_element->defined) {
-            switch (value_element->value_type) {
-                case AX_VALUE_TYPE_INT:
-                    cJSON_AddNumberToObject(object, nskp->key, (double)value_element->int_value);
-                    break;
-                case AX_VALUE_TYPE_BOOL:
-                    cJSON_AddBoolToObject(object, nskp->key, value_element->bool_value);
-                    break;
-                case AX_VALUE_TYPE_DOUBLE:
-                    cJSON_AddNumberToObject(object, nskp->key, value_element->double_value);
-                    break;
-                case AX_VALUE_TYPE_STRING:
-                    cJSON_AddStringToObject(object, nskp->key, value_element->str_value);
-                    break;
-                case AX_VALUE_TYPE_ELEMENT:
-                    cJSON_AddStringToObject(object, nskp->key, value_element->elem_str_value);
-                    break;
-                default:
-                    cJSON_AddNullToObject(object, nskp->key);
-                    break;
-            }
+        int level = event_topic_level(nskp->key);
+        if (level >= 0) {
+            if (level == 0 && value_element->str_value &&
+                strcmp(value_element->str_value, "CameraApplicationPlatform") == 0)
+                view->topics[0] = "acap";
+            else
+                view->topics[level] = value_element->str_value;
+            continue;
         }
-    }
-
-    /* Build topic path */
-    char topic[200];
-    strncpy(topic, topics[0], sizeof(topic) - 1);
-    topic[sizeof(topic) - 1] = '\0';
-    for (int i = 1; i < 6; i++) {
-        if (strlen(topics[i]) > 0) {
-            size_t remaining = sizeof(topic) - strlen(topic) - 1;
-            if (remaining > 1) {
-                strncat(topic, "/", remaining);
-                remaining = sizeof(topic) - strlen(topic) - 1;
-                strncat(topic, topics[i], remaining);
-            }
+        if (!value_element->defined)
+            continue;
+        if (view->count < ACAP_EVENT_MAX_PROPERTIES) {
+            view->properties[view->count].name = nskp->key;
+            view->properties[view->count].value = value_element;
+            view->count++;
+        } else {
+            view->overflow = 1;
         }
     }
-
-    cJSON_AddStringToObject(object, "event", topic);
-    return object;
+    event_view_join_topic(view);
+    return 1;
 }
 
-static void
-ACAP_EVENTS_Main_Callback(guint subscription, AXEvent* axEvent, gpointer user_data) {
-    LOG_TRACE("%s:\n", __func__);
-
-    cJSON* eventData = ACAP_EVENTS_Parse(axEvent);
-    if (!eventData) {
-        ax_event_free(axEvent);
-        return;
-    }
-
-    if (user_data)
-        cJSON_AddItemReferenceToObject(eventData, "source", (cJSON*)user_data);
-    if (EVENT_USER_CALLBACK)
-        EVENT_USER_CALLBACK(eventData, user_data);
-    cJSON_Delete(eventData);
-    ax_event_free(axEvent);
+static void event_view_clear(struct ACAP_Event_T* view) {
+    g_free(view->topicHeap);
+    view->topicHeap = NULL;
 }
 
-/*-----------------------------------------------------
+static const T_ValueElement* event_view_find(const struct ACAP_Event_T* view, const char* name) {
+    if (!view || !name)
+        return NULL;
+    for (int i = 0; i < view->count; i++)
+        if (strcmp(view->properties[i].name, name) == 0)
+            return view->properties[i].value;
+    if (!view->overflow)
+        return NULL;
+
+    /* Rare: the event has more properties than the view holds inline */
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value_element;
+    g_hash_table_iter_init(&iter, view->set->key_values);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value_element))
+        if (value_element->defined && strcmp(nskp->key, name) == 0 && event_topic_level(nskp->key) < 0)
+            return value_element;
+    return NULL;
+}
+
+static ACAP_EVENT_Value_Type event_value_type(const T_ValueElement* value) {
+    if (!value)
+        return ACAP_EVENT_NONE;
+    switch (value->value_type) {
+        case AX_VALUE_TYPE_INT:     return ACAP_EVENT_INT;
+        case AX_VALUE_TYPE_BOOL:    return ACAP_EVENT_BOOL;
+        case AX_VALUE_TYPE_DOUBLE:  return ACAP_EVENT_DOUBLE;
+        case AX_VALUE_TYPE_STRING:  return value->str_value ? ACAP_EVENT_STRING : ACAP_EVENT_NONE;
+        case AX_VALUE_TYPE_ELEMENT: return value->elem_str_value ? ACAP_EVENT_STRING : ACAP_EVENT_NONE;
+        default:                    return ACAP_EVENT_NONE;
+    }
+}
+
+static double event_value_number(const T_ValueElement* value) {
+    switch (event_value_type(value)) {
+        case ACAP_EVENT_INT:    return (double)value->int_value;
+        case ACAP_EVENT_BOOL:   return value->bool_value ? 1.0 : 0.0;
+        case ACAP_EVENT_DOUBLE: return value->double_value;
+        default:                return 0.0;
+    }
+}
+
+static void event_value_to_json(cJSON* object, const char* name, const T_ValueElement* value) {
+    switch (value->value_type) {
+        case AX_VALUE_TYPE_INT:
+            cJSON_AddNumberToObject(object, name, (double)value->int_value);
+            break;
+        case AX_VALUE_TYPE_BOOL:
+            cJSON_AddBoolToObject(object, name, value->bool_value);
+            break;
+        case AX_VALUE_TYPE_DOUBLE:
+            cJSON_AddNumberToObject(object, name, value->double_value);
+            break;
+        case AX_VALUE_TYPE_STRING:
+            cJSON_AddStringToObject(object, name, value->str_value);
+            break;
+        case AX_VALUE_TYPE_ELEMENT:
+            cJSON_AddStringToObject(object, name, value->elem_str_value);
+            break;
+        default:
+            cJSON_AddNullToObject(object, name);
+            break;
+    }
+}
+
+int ACAP_EVENTS_SetViewCallback(ACAP_EVENTS_View_Callback callback) {
+    LOG_TRACE("%s: Entry\n", __func__);
+    EVENT_VIEW_CALLBACK = callback;
+    return 1;
+}
+
+const char* ACAP_EVENT_Topic(const ACAP_Event event) {
+    return event ? event->topic : NULL;
+}
+
+const char* ACAP_EVENT_Topic_Level(const ACAP_Event event, int level) {
+    if (!event || level < 0 || level >= ACAP_EVENT_MAX_TOPICS)
+        return NULL;
+    return event->topics[level];
+}
+
+int ACAP_EVENT_Count(const ACAP_Event event) {
+    if (!event)
+        return 0;
+    if (!event->overflow)
+        return event->count;
+
+    int count = 0;
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value_element;
+    g_hash_table_iter_init(&iter, event->set->key_values);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value_element))
+        if (value_element->defined && event_topic_level(nskp->key) < 0)
+            count++;
+    return count;
+}
+
+const char* ACAP_EVENT_Name(const ACAP_Event event, int index) {
+    if (!event || index < 0)
+        return NULL;
+    if (index < event->count)
+        return event->properties[index].name;
+    if (!event->overflow)
+        return NULL;
+
+    int i = 0;
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value_element;
+    g_hash_table_iter_init(&iter, event->set->key_values);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value_element))
+        if (value_element->defined && event_topic_level(nskp->key) < 0 && i++ == index)
+            return nskp->key;
+    return NULL;
+}
+
+ACAP_EVENT_Value_Type ACAP_EVENT_Type(const ACAP_Event event, const char* name) {
+    return event_value_type(event_view_find(event, name));
+}
+
+int ACAP_EVENT_Bool(const ACAP_Event event, const char* name) {
+    return event_value_number(event_view_find(event, name)) != 0.0;
+}
+
+int ACAP_EVENT_Int(const ACAP_Event event, const char* name) {
+    return (int)event_value_number(event_view_find(event, name));
+}
+
+double ACAP_EVENT_Double(const ACAP_Event event, const char* name) {
+    return event_value_number(event_view_find(event, name));
+}
+
+const char* ACAP_EVENT_String(const ACAP_Event event, const char* name) {
+    const T_ValueElement* value = event_view_find(event, name);
+    if (event_value_type(value) != ACAP_EVENT_STRING)
+        return NULL;
+    return value->value_type == AX_VALUE_TYPE_ELEMENT ? value->elem_str_value : value->str_value;
+}
+
+cJSON* ACAP_EVENT_JSON(const ACAP_Event event) {
+    if (!event)
+        return NULL;
+    cJSON* object = cJSON_CreateObject();
+    if (!event->overflow) {
+        for (int i = 0; i < event->count; i++)
+            event_value_to_json(object, event->properties[i].name, event->properties[i].value);
+    } else {
+        GHashTableIter iter;
+        T_KeyPair* nskp;
+        T_ValueElement* value_element;
+        g_hash_table_iter_init(&iter, event->set->key_values);
+        while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value_element))
+            if (value_element->defined && event_topic_level(nskp->key) < 0)
+                event_value_to_json(object, nskp->key, value_element);
+    }
+    cJSON_AddStringToObject(object, "event", event->topic);
+    return object;
+}
+
+cJSON* ACAP_EVENTS_Parse(AXEvent* axEvent) {
+    LOG_TRACE("%s: Entry\n", __func__);
+
+    struct ACAP_Event_T view;
+    if (!event_view_init(&view, axEvent))
+        return NULL;
+    cJSON* object = ACAP_EVENT_JSON(&view);
+    event_view_clear(&view);
+    return object;
+}
+
+/*-----------------------------------------------------
+ * Recent event history
+ *
+ * The last delivered events are kept as compact records in a fixed ring
+ * served by GET /events. A record holds the topic and the typed property
+ * values packed back to back; JSON is only produced when /events is
+ * requested.
+ *
+ * Writers never take a lock. A record is built on the writer's stack,
+ * then a sequence number is claimed with one atomic add and the slot is
+ * published seqlock style: its version is odd while the record is copied
+ * in. Readers copy the slot and retry if the version moved meanwhile. A
+ * writer that laps a slot another writer is still in drops its record
+ * rather than wait. ACAP_EVENTS_SetHistory() swaps the whole ring and
+ * frees the old one once no writer or reader is left inside it.
+ *-----------------------------------------------------*/
+#define HISTORY_RECORD_SIZE   512
+#define HISTORY_READ_ATTEMPTS 100   /* Retries on a slot being written before giving up on it */
+
+typedef struct {
+    size_t version;                 /* Seqlock: odd while the slot is written */
+    size_t sequence;                /* 0 for an empty slot */
+    gint64 time;                    /* Milliseconds since the epoch */
+    guint  subscription;
+    guint  length;                  /* Bytes used in data */
+    /* topic '\0', then per property: type, name '\0', value (int, bool byte, double or text '\0') */
+    char   data[HISTORY_RECORD_SIZE - 3 * sizeof(gint64) - 2 * sizeof(guint)];
+} T_HistoryRecord;
+
+#define HISTORY_HEADER offsetof(T_HistoryRecord, data)
+#define HISTORY_FIELDS offsetof(T_HistoryRecord, sequence)  /* Start of what a writer copies */
+
+typedef struct {
+    size_t          mask;
+    size_t          first;          /* Oldest sequence written to this ring */
+    T_HistoryRecord records[];
+} T_HistoryRing;
+
+static struct {
+    T_HistoryRing* ring;
+    size_t         next;            /* Last sequence handed out */
+    int            users;           /* Writers and readers inside a ring */
+} history = { NULL, 0, 0 };
+
+/* Enter and leave the current ring; it is not freed while a user is inside */
+static T_HistoryRing* history_enter(void) {
+    __atomic_add_fetch(&history.users, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&history.ring, __ATOMIC_SEQ_CST);
+}
+
+static void history_leave(void) {
+    __atomic_sub_fetch(&history.users, 1, __ATOMIC_RELEASE);
+}
+
+/* Append bytes to a record; returns 0 if they do not fit */
+static int history_put(T_HistoryRecord* record, const void* data, size_t length) {
+    if (length > sizeof(record->data) - record->length)
+        return 0;
+    memcpy(record->data + record->length, data, length);
+    record->length += length;
+    return 1;
+}
+
+static int history_put_text(T_HistoryRecord* record, const char* text) {
+    text = text ? text : "";
+    return history_put(record, text, strlen(text) + 1);
+}
+
+static int history_put_property(T_HistoryRecord* record, const char* name, const T_ValueElement* value) {
+    unsigned char type = (unsigned char)event_value_type(value);
+    unsigned char flag = type == ACAP_EVENT_BOOL && value->bool_value;
+    if (!history_put(record, &type, 1) || !history_put_text(record, name))
+        return 0;
+    switch (type) {
+        case ACAP_EVENT_INT:    return history_put(record, &value->int_value, sizeof(value->int_value));
+        case ACAP_EVENT_BOOL:   return history_put(record, &flag, 1);
+        case ACAP_EVENT_DOUBLE: return history_put(record, &value->double_value, sizeof(value->double_value));
+        case ACAP_EVENT_STRING:
+            return history_put_text(record, value->value_type == AX_VALUE_TYPE_ELEMENT ? value->elem_str_value : value->str_value);
+        default:                return 1;
+    }
+}
+
+static void history_record(const struct ACAP_Event_T* view, guint subscription) {
+    if (!__atomic_load_n(&history.ring, __ATOMIC_RELAXED))
+        return;
+
+    T_HistoryRecord record;
+    record.time = g_get_real_time() / 1000;
+    record.subscription = subscription;
+    record.length = 0;
+    history_put(&record, view->topic, strnlen(view->topic, sizeof(record.data) / 2));
+    history_put(&record, "", 1);
+    /* Properties that do not fit are left out */
+    for (int i = 0; i < view->count; i++) {
+        guint mark = record.length;
+        if (!history_put_property(&record, view->properties[i].name, view->properties[i].value))
+            record.length = mark;
+    }
+
+    T_HistoryRing* ring = history_enter();
+    if (ring) {
+        record.sequence = __atomic_add_fetch(&history.next, 1, __ATOMIC_RELAXED);
+        T_HistoryRecord* slot = &ring->records[record.sequence & ring->mask];
+        size_t version = __atomic_load_n(&slot->version, __ATOMIC_RELAXED);
+        if (!(version & 1) &&
+            __atomic_compare_exchange_n(&slot->version, &version, version + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            /* A writer delayed past a full lap must not replace the newer record */
+            if (slot->sequence < record.sequence)
+                memcpy((char*)slot + HISTORY_FIELDS, (const char*)&record + HISTORY_FIELDS,
+                       HISTORY_HEADER - HISTORY_FIELDS + record.length);
+            __atomic_store_n(&slot->version, version + 2, __ATOMIC_RELEASE);
+        }
+    }
+    history_leave();
+}
+
+/* Copy the record with this sequence; returns 0 if it was overwritten, dropped or never written */
+static int history_read(const T_HistoryRing* ring, size_t sequence, T_HistoryRecord* copy) {
+    if (sequence < ring->first)
+        return 0;
+    const T_HistoryRecord* slot = &ring->records[sequence & ring->mask];
+    for (int attempt = 0; attempt < HISTORY_READ_ATTEMPTS; attempt++) {
+        if (attempt)
+            g_thread_yield();
+        size_t version = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+        if (version & 1)
+            continue;
+        memcpy(copy, slot, HISTORY_HEADER);
+        if (copy->length > sizeof(copy->data))
+            copy->length = sizeof(copy->data);
+        memcpy(copy->data, slot->data, copy->length);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->version, __ATOMIC_RELAXED) != version)
+            continue;               /* Torn by a writer, copy again */
+        if (copy->sequence >= sequence)
+            return copy->sequence == sequence;
+        /* An older record: the writer of this sequence has not published it yet */
+    }
+    return 0;
+}
+
+/* The properties of a record as a JSON object */
+static cJSON* history_data(const T_HistoryRecord* record) {
+    cJSON* data = cJSON_CreateObject();
+    const char* at = record->data + strlen(record->data) + 1;
+    const char* end = record->data + record->length;
+    while (data && at < end) {
+        unsigned char type = (unsigned char)*at++;
+        const char* name = at;
+        at += strlen(name) + 1;
+        cJSON* value = NULL;
+        switch (type) {
+            case ACAP_EVENT_INT: {
+                int number;
+                memcpy(&number, at, sizeof(number));
+                at += sizeof(number);
+                value = cJSON_CreateNumber(number);
+                break;
+            }
+            case ACAP_EVENT_BOOL:
+                value = cJSON_CreateBool(*at++);
+                break;
+            case ACAP_EVENT_DOUBLE: {
+                double number;
+                memcpy(&number, at, sizeof(number));
+                at += sizeof(number);
+                value = isfinite(number) ? cJSON_CreateNumber(number) : cJSON_CreateNull();
+                break;
+            }
+            case ACAP_EVENT_STRING:
+                value = cJSON_CreateString(at);
+                at += strlen(at) + 1;
+                break;
+            default:
+                value = cJSON_CreateNull();
+                break;
+        }
+        cJSON_AddItemToObject(data, name, value);
+    }
+    return data;
+}
+
+int ACAP_EVENTS_SetHistory(int capacity) {
+    if (capacity < 0)
+        return 0;
+    history_configured = 1;
+
+    T_HistoryRing* ring = NULL;
+    size_t size = 1;
+    if (capacity > 0) {
+        while (size < (size_t)capacity)
+            size <<= 1;
+        ring = calloc(1, sizeof(T_HistoryRing) + size * sizeof(T_HistoryRecord));
+        if (ring) {
+            ring->mask = size - 1;
+            ring->first = __atomic_load_n(&history.next, __ATOMIC_RELAXED) + 1;
+        } else {
+            LOG_WARN("%s: Unable to allocate %zu records\n", __func__, size);
+        }
+    }
+
+    /* Writers never wait for a resize; the resize waits for those still in the old ring */
+    T_HistoryRing* old = __atomic_exchange_n(&history.ring, ring, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&history.users, __ATOMIC_SEQ_CST))
+        g_thread_yield();
+    free(old);
+    return capacity == 0 || ring != NULL;
+}
+
+static void ACAP_ENDPOINT_events(const ACAP_HTTP_Response response, const ACAP_HTTP_Request request) {
+    const char* method = ACAP_HTTP_Get_Method(request);
+    if (!method || strcmp(method, "GET") != 0) {
+        ACAP_HTTP_Respond_Error(response, 405, "Method Not Allowed - Only GET supported");
+        return;
+    }
+    T_HistoryRing* ring = history_enter();
+    if (!ring) {
+        history_leave();
+        ACAP_HTTP_Respond_Error(response, 404, "Event history is disabled");
+        return;
+    }
+    size_t last = __atomic_load_n(&history.next, __ATOMIC_RELAXED);
+    size_t capacity = ring->mask + 1;
+
+    char* sinceParam = ACAP_HTTP_Request_Param(request, "since");
+    char* topic = ACAP_HTTP_Request_Param(request, "topic");
+    unsigned long long since = sinceParam ? strtoull(sinceParam, NULL, 10) : 0;
+    size_t topicLength = topic ? strlen(topic) : 0;
+    free(sinceParam);
+
+    /* Oldest record still in the ring first; nothing if "since" is at or past the latest */
+    size_t first = last > capacity ? last - capacity + 1 : 1;
+    if (since >= last)
+        first = last + 1;
+    else if (since >= first)
+        first = (size_t)since + 1;
+
+    cJSON_Arena* arena = cJSON_ArenaBegin(0);
+    cJSON* result = cJSON_CreateObject();
+    cJSON_AddNumberToObject(result, "sequence", last);
+    cJSON_AddNumberToObject(result, "capacity", capacity);
+    cJSON* list = cJSON_AddArrayToObject(result, "events");
+
+    T_HistoryRecord record;
+    for (size_t sequence = first; sequence <= last; sequence++) {
+        if (!history_read(ring, sequence, &record))
+            continue;
+        if (topicLength && strncmp(record.data, topic, topicLength) != 0)
+            continue;
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "sequence", sequence);
+        cJSON_AddNumberToObject(item, "time", record.time);
+        cJSON_AddNumberToObject(item, "subscription", record.subscription);
+        cJSON_AddStringToObject(item, "event", record.data);
+        cJSON_AddItemToObject(item, "data", history_data(&record));
+        cJSON_AddItemToArray(list, item);
+    }
+    history_leave();
+    free(topic);
+
+    ACAP_HTTP_Respond_JSON(response, result);
+    cJSON_ArenaEnd(arena);
+}
+
+/*-----------------------------------------------------
+ * Event state resolution
+ *
+ * Device events carry their on/off state in one of a few dozen property
+ * names ("active", "state", "LogicalState", ...), and a given topic
+ * always uses the same one. The first event on a topic probes the list;
+ * the answer is cached by topic string, so later events on the topic
+ * cost one hash lookup and one property lookup.
+ *-----------------------------------------------------*/
+#define EVENT_STATE_CACHE_MAX 256
+
+static const char* EVENT_STATE_PROPERTIES[] = {
+    "active", "state", "triggered", "LogicalState",
+    "ready", "Open", "lost", "Detected", "recording",
+    "accessed", "connected", "day", "sensor_level",
+    "disruption", "alert", "fan_failure", "Failed",
+    "limit_exceeded", "abr_error", "tampering",
+    "signal_status_ok", "Playing", NULL
+};
+
+static GHashTable*     event_state_cache = NULL;     /* topic -> property index + 1, 0 = no state */
+static pthread_mutex_t event_state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Returns 1 and sets index (-1 = topic has no state property) if the topic is known */
+static int event_state_lookup(const char* topic, int* index) {
+    gpointer value = NULL;
+    int found = 0;
+    pthread_mutex_lock(&event_state_lock);
+    if (event_state_cache)
+        found = g_hash_table_lookup_extended(event_state_cache, topic, NULL, &value);
+    pthread_mutex_unlock(&event_state_lock);
+    *index = GPOINTER_TO_INT(value) - 1;
+    return found;
+}
+
+static void event_state_store(const char* topic, int index) {
+    pthread_mutex_lock(&event_state_lock);
+    if (!event_state_cache)
+        event_state_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    if (g_hash_table_size(event_state_cache) < EVENT_STATE_CACHE_MAX)
+        g_hash_table_replace(event_state_cache, g_strdup(topic), GINT_TO_POINTER(index + 1));
+    pthread_mutex_unlock(&event_state_lock);
+}
+
+static int event_state_text(const char* text) {
+    return strcmp(text, "1") == 0 || strcmp(text, "true") == 0;
+}
+
+static int event_state_value(const T_ValueElement* value) {
+    if (event_value_type(value) == ACAP_EVENT_STRING)
+        return event_state_text(value->value_type == AX_VALUE_TYPE_ELEMENT ? value->elem_str_value : value->str_value);
+    return event_value_number(value) != 0.0;
+}
+
+int ACAP_EVENT_State(const ACAP_Event event) {
+    if (!event)
+        return -1;
+
+    int index;
+    if (event_state_lookup(event->topic, &index)) {
+        if (index < 0)
+            return -1;
+        const T_ValueElement* value = event_view_find(event, EVENT_STATE_PROPERTIES[index]);
+        if (value)
+            return event_state_value(value);
+    }
+    for (index = 0; EVENT_STATE_PROPERTIES[index]; index++) {
+        const T_ValueElement* value = event_view_find(event, EVENT_STATE_PROPERTIES[index]);
+        if (value) {
+            event_state_store(event->topic, index);
+            return event_state_value(value);
+        }
+    }
+    event_state_store(event->topic, -1);
+    return -1;
+}
+
+/* Only bool, number and string properties carry a state */
+static int event_state_scalar(const cJSON* item) {
+    return cJSON_IsBool(item) || cJSON_IsNumber(item) || cJSON_IsString(item);
+}
+
+static int event_state_item(const cJSON* item) {
+    if (cJSON_IsBool(item))
+        return cJSON_IsTrue(item) ? 1 : 0;
+    if (cJSON_IsNumber(item))
+        return item->valueint ? 1 : 0;
+    if (cJSON_IsString(item))
+        return event_state_text(item->valuestring);
+    return 0;
+}
+
+int ACAP_EVENTS_Event_State(cJSON* event) {
+    cJSON* topic = cJSON_GetObjectItem(event, "event");
+    if (!cJSON_IsString(topic))
+        return -1;
+
+    int index;
+    if (event_state_lookup(topic->valuestring, &index)) {
+        if (index < 0)
+            return -1;
+        cJSON* item = cJSON_GetObjectItem(event, EVENT_STATE_PROPERTIES[index]);
+        if (event_state_scalar(item))
+            return event_state_item(item);
+    }
+    for (index = 0; EVENT_STATE_PROPERTIES[index]; index++) {
+        cJSON* item = cJSON_GetObjectItem(event, EVENT_STATE_PROPERTIES[index]);
+        if (event_state_scalar(item)) {
+            event_state_store(topic->valuestring, index);
+            return event_state_item(item);
+        }
+    }
+    event_state_store(topic->valuestring, -1);
+    return -1;
+}
+
+/*-----------------------------------------------------
+ * Event pipeline statistics
+ *
+ * Counters are updated with relaxed atomics on the delivery path and
+ * sampled into the "eventStats" status group by a main loop timer, so
+ * the HTTP thread never walks the subscription or declaration tables.
+ *-----------------------------------------------------*/
+#define EVENT_LATENCY_BUCKETS 6
+
+static const gint64 EVENT_LATENCY_LIMITS[EVENT_LATENCY_BUCKETS - 1] = { 10, 100, 1000, 10000, 100000 };
+static const char*  EVENT_LATENCY_NAMES[EVENT_LATENCY_BUCKETS] = { "10us", "100us", "1ms", "10ms", "100ms", "slower" };
+
+typedef struct {
+    size_t  received;                           /* From axevent (or replay), before the filter */
+    size_t  filtered;                           /* Rejected by the subscription filter */
+    size_t  delivered;                          /* Handed to the callbacks */
+    size_t  dropped;                            /* Dedupe, rate limit or full queue */
+    size_t  coalesced;                          /* Replaced by a newer event while held */
+    guint64 parse_us;                           /* View and cJSON construction, total */
+    guint64 callback_us;                        /* User callbacks, total */
+    gint64  callback_max_us;
+    size_t  latency[EVENT_LATENCY_BUCKETS];     /* Callback time histogram */
+    size_t  sampled;                            /* received at the last sample (main loop only) */
+} T_EventStats;
+
+static void event_stats_delivered(T_EventStats* stats, gint64 parse_us, gint64 callback_us) {
+    int bucket = 0;
+    while (bucket < EVENT_LATENCY_BUCKETS - 1 && callback_us >= EVENT_LATENCY_LIMITS[bucket])
+        bucket++;
+    __atomic_add_fetch(&stats->delivered, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->parse_us, (guint64)parse_us, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->callback_us, (guint64)callback_us, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->latency[bucket], 1, __ATOMIC_RELAXED);
+    gint64 max = __atomic_load_n(&stats->callback_max_us, __ATOMIC_RELAXED);
+    while (callback_us > max &&
+           !__atomic_compare_exchange_n(&stats->callback_max_us, &max, callback_us, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/*-----------------------------------------------------
+ * Subscription filters
+ *
+ * A subscription "filter" is compiled once into postfix code, e.g.
+ *     active == true && zone in [1,3]
+ *     -> EQ active true, IN zone [1,3], AND
+ * Matching looks up only the referenced properties in one pass over the
+ * SDK key-value set, so an event that does not match is freed before
+ * the gate, the dispatch queue or any cJSON sees it.
+ *
+ *     or    := and ("||" and)*
+ *     and   := unary ("&&" unary)*
+ *     unary := "!" unary | "(" or ")" | name [op value | "in" "[" value ("," value)* "]"]
+ *     op    := == != < <= > >=
+ *     value := number | true | false | 'text' | "text"
+ *
+ * A comparison on a property the event does not carry is false; a bare
+ * name is true when the property is present and not 0, false or empty.
+ *-----------------------------------------------------*/
+#define FILTER_MAX_NAMES   8
+#define FILTER_MAX_CODE    64
+#define FILTER_MAX_VALUES  64
+#define FILTER_MAX_DEPTH   64       /* Nested "!" and "(", bounds the parser's recursion */
+
+typedef enum {
+    FILTER_TRUTHY, FILTER_EQ, FILTER_NE, FILTER_LT, FILTER_LE, FILTER_GT, FILTER_GE,
+    FILTER_IN, FILTER_NOT, FILTER_AND, FILTER_OR
+} T_FilterOp;
+
+typedef struct {
+    unsigned char op;
+    unsigned char name;             /* Index into names[] */
+    unsigned char value;            /* Index into values[] */
+    unsigned char count;            /* Values in the FILTER_IN list */
+} T_FilterCode;
+
+typedef struct {
+    double number;
+    int    numeric;                 /* number holds the value */
+    char*  text;                    /* Quoted text, NULL for numbers and booleans */
+} T_FilterValue;
+
+typedef struct {
+    char*         names[FILTER_MAX_NAMES];
+    int           nameCount;
+    T_FilterCode  code[FILTER_MAX_CODE];
+    int           length;
+    T_FilterValue values[FILTER_MAX_VALUES];
+    int           valueCount;
+} T_Filter;
+
+typedef struct {
+    const char* at;
+    T_Filter*   filter;
+    const char* error;
+    int         depth;
+} T_FilterParser;
+
+static void filter_free(T_Filter* filter) {
+    if (!filter)
+        return;
+    for (int i = 0; i < filter->nameCount; i++)
+        free(filter->names[i]);
+    for (int i = 0; i < filter->valueCount; i++)
+        free(filter->values[i].text);
+    free(filter);
+}
+
+static int filter_fail(T_FilterParser* parser, const char* error) {
+    if (!parser->error)
+        parser->error = error;
+    return 0;
+}
+
+static int filter_accept(T_FilterParser* parser, const char* token) {
+    while (*parser->at == ' ' || *parser->at == '\t')
+        parser->at++;
+    size_t length = strlen(token);
+    if (strncmp(parser->at, token, length) != 0)
+        return 0;
+    parser->at += length;
+    return 1;
+}
+
+static int filter_is_name(char c, int first) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+           (!first && ((c >= '0' && c <= '9') || c == '.' || c == '-'));
+}
+/* A word such as "in" or "true", not followed by more name characters */
+static int filter_keyword(T_FilterParser* parser, const char* word) {
+    const char* mark = parser->at;
+    if (filter_accept(parser, word) && !filter_is_name(*parser->at, 0))
+        return 1;
+    parser->at = mark;
+    return 0;
+}
+
+static int filter_emit(T_FilterParser* parser, T_FilterOp op, int name, int value, int count) {
+    T_Filter* filter = parser->filter;
+    if (filter->length >= FILTER_MAX_CODE)
+        return filter_fail(parser, "expression too long");
+    filter->code[filter->length++] = (T_FilterCode){ op, name, value, count };
+    return 1;
+}
+
+
+/* Returns the name index, or -1 */
+static int filter_name(T_FilterParser* parser) {
+    T_Filter* filter = parser->filter;
+    filter_accept(parser, "");
+    const char* start = parser->at;
+    if (!filter_is_name(*start, 1)) {
+        filter_fail(parser, "expected property name");
+        return -1;
+    }
+    while (filter_is_name(*parser->at, 0))
+        parser->at++;
+    size_t length = parser->at - start;
+
+    for (int i = 0; i < filter->nameCount; i++)
+        if (strlen(filter->names[i]) == length && strncmp(filter->names[i], start, length) == 0)
+            return i;
+    if (filter->nameCount >= FILTER_MAX_NAMES) {
+        filter_fail(parser, "too many properties");
+        return -1;
+    }
+    filter->names[filter->nameCount] = strndup(start, length);
+    if (!filter->names[filter->nameCount]) {
+        filter_fail(parser, "out of memory");
+        return -1;
+    }
+    return filter->nameCount++;
+}
+
+/* Returns the value index, or -1 */
+static int filter_value(T_FilterParser* parser) {
+    T_Filter* filter = parser->filter;
+    if (filter->valueCount >= FILTER_MAX_VALUES) {
+        filter_fail(parser, "too many values");
+        return -1;
+    }
+    T_FilterValue* value = &filter->values[filter->valueCount];
+    filter_accept(parser, "");
+    char quote = *parser->at;
+
+    if (quote == '\'' || quote == '"') {
+        const char* end = strchr(parser->at + 1, quote);
+        if (!end) {
+            filter_fail(parser, "unterminated text");
+            return -1;
+        }
+        value->text = strndup(parser->at + 1, end - parser->at - 1);
+        if (!value->text) {
+            filter_fail(parser, "out of memory");
+            return -1;
+        }
+        char* number_end;
+        value->number = strtod(value->text, &number_end);
+        value->numeric = value->text[0] && *number_end == '\0';
+        parser->at = end + 1;
+    } else if (filter_keyword(parser, "true")) {
+        value->number = 1;
+        value->numeric = 1;
+    } else if (filter_keyword(parser, "false")) {
+        value->number = 0;
+        value->numeric = 1;
+    } else {
+        char* end;
+        value->number = strtod(parser->at, &end);
+        if (end == parser->at) {
+            filter_fail(parser, "expected value");
+            return -1;
+        }
+        value->numeric = 1;
+        parser->at = end;
+    }
+    return filter->valueCount++;
+}
+
+static int filter_or(T_FilterParser* parser);
+
+static int filter_unary(T_FilterParser* parser) {
+    if (filter_accept(parser, "!")) {
+        if (++parser->depth > FILTER_MAX_DEPTH)
+            return filter_fail(parser, "nested too deeply");
+        int ok = filter_unary(parser) && filter_emit(parser, FILTER_NOT, 0, 0, 0);
+        parser->depth--;
+        return ok;
+    }
+    if (filter_accept(parser, "(")) {
+        if (++parser->depth > FILTER_MAX_DEPTH)
+            return filter_fail(parser, "nested too deeply");
+        int ok = filter_or(parser);
+        parser->depth--;
+        if (!ok)
+            return 0;
+        return filter_accept(parser, ")") ? 1 : filter_fail(parser, "expected )");
+    }
+
+    int name = filter_name(parser);
+    if (name < 0)
+        return 0;
+
+    static const struct { const char* token; T_FilterOp op; } ops[] = {
+        { "==", FILTER_EQ }, { "!=", FILTER_NE }, { "<=", FILTER_LE },
+        { ">=", FILTER_GE }, { "<", FILTER_LT }, { ">", FILTER_GT }
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (filter_accept(parser, ops[i].token)) {
+            int value = filter_value(parser);
+            return value >= 0 && filter_emit(parser, ops[i].op, name, value, 1);
+        }
+    }
+
+    if (filter_keyword(parser, "in")) {
+        if (!filter_accept(parser, "["))
+            return filter_fail(parser, "expected [");
+        int first = -1, count = 0;
+        do {
+            int value = filter_value(parser);
+            if (value < 0)
+                return 0;
+            if (first < 0)
+                first = value;
+            count++;
+        } while (filter_accept(parser, ","));
+        if (!filter_accept(parser, "]"))
+            return filter_fail(parser, "expected ]");
+        return filter_emit(parser, FILTER_IN, name, first, count);
+    }
+    return filter_emit(parser, FILTER_TRUTHY, name, 0, 0);
+}
+
+static int filter_and(T_FilterParser* parser) {
+    if (!filter_unary(parser))
+        return 0;
+    while (filter_accept(parser, "&&"))
+        if (!filter_unary(parser) || !filter_emit(parser, FILTER_AND, 0, 0, 0))
+            return 0;
+    return 1;
+}
+
+static int filter_or(T_FilterParser* parser) {
+    if (!filter_and(parser))
+        return 0;
+    while (filter_accept(parser, "||"))
+        if (!filter_and(parser) || !filter_emit(parser, FILTER_OR, 0, 0, 0))
+            return 0;
+    return 1;
+}
+
+static T_Filter* filter_compile(const char* expression) {
+    T_Filter* filter = calloc(1, sizeof(T_Filter));
+    if (!filter)
+        return NULL;
+    T_FilterParser parser = { expression, filter, NULL, 0 };
+    int ok = filter_or(&parser);
+    filter_accept(&parser, "");     /* Trailing blanks */
+    if (!ok || *parser.at != '\0') {
+        LOG_WARN("%s: Invalid filter \"%s\": %s at position %d\n", __func__, expression,
+                 parser.error ? parser.error : "unexpected input", (int)(parser.at - expression));
+        filter_free(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static const char* filter_text(const T_ValueElement* value) {
+    if (event_value_type(value) != ACAP_EVENT_STRING)
+        return NULL;
+    return value->value_type == AX_VALUE_TYPE_ELEMENT ? value->elem_str_value : value->str_value;
+}
+
+/* Numeric reading of a property; text properties such as "1" or "true" count */
+static int filter_number(const T_ValueElement* value, double* number) {
+    const char* text = filter_text(value);
+    if (!text) {
+        if (event_value_type(value) == ACAP_EVENT_NONE)
+            return 0;
+        *number = event_value_number(value);
+        return 1;
+    }
+    if (strcmp(text, "true") == 0 || strcmp(text, "false") == 0) {
+        *number = text[0] == 't';
+        return 1;
+    }
+    char* end;
+    *number = strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+static int filter_compare(const T_ValueElement* value, T_FilterOp op, const T_FilterValue* constant) {
+    if (!value)
+        return 0;
+    const char* text = filter_text(value);
+    int order;
+    double number;
+    if (constant->text && text)
+        order = strcmp(text, constant->text);
+    else if (constant->numeric && filter_number(value, &number))
+        order = (number > constant->number) - (number < constant->number);
+    else
+        return 0;
+
+    switch (op) {
+        case FILTER_EQ: return order == 0;
+        case FILTER_NE: return order != 0;
+        case FILTER_LT: return order < 0;
+        case FILTER_LE: return order <= 0;
+        case FILTER_GT: return order > 0;
+        case FILTER_GE: return order >= 0;
+        default:        return 0;
+    }
+}
+
+static int filter_match(const T_Filter* filter, AXEvent* axEvent) {
+    const T_ValueSet* set = (const T_ValueSet*)ax_event_get_key_value_set(axEvent);
+    if (!set || !set->key_values)
+        return 0;
+
+    const T_ValueElement* found[FILTER_MAX_NAMES] = { NULL };
+    int missing = filter->nameCount;
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value;
+    g_hash_table_iter_init(&iter, set->key_values);
+    while (missing && g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value)) {
+        if (!value->defined)
+            continue;
+        for (int i = 0; i < filter->nameCount; i++) {
+            if (!found[i] && strcmp(nskp->key, filter->names[i]) == 0) {
+                found[i] = value;
+                missing--;
+                break;
+            }
+        }
+    }
+
+    unsigned char stack[FILTER_MAX_CODE];
+    int top = 0;
+    for (int pc = 0; pc < filter->length; pc++) {
+        const T_FilterCode* code = &filter->code[pc];
+        const T_ValueElement* property = found[code->name];
+        switch (code->op) {
+            case FILTER_NOT:
+                stack[top - 1] = !stack[top - 1];
+                break;
+            case FILTER_AND:
+                top--;
+                stack[top - 1] = stack[top - 1] && stack[top];
+                break;
+            case FILTER_OR:
+                top--;
+                stack[top - 1] = stack[top - 1] || stack[top];
+                break;
+            case FILTER_TRUTHY: {
+                double number;
+                const char* text = filter_text(property);
+                stack[top++] = filter_number(property, &number) ? number != 0 : (text && text[0]);
+                break;
+            }
+            case FILTER_IN: {
+                int match = 0;
+                for (int i = 0; !match && i < code->count; i++)
+                    match = filter_compare(property, FILTER_EQ, &filter->values[code->value + i]);
+                stack[top++] = match;
+                break;
+            }
+            default:
+                stack[top++] = filter_compare(property, code->op, &filter->values[code->value]);
+                break;
+        }
+    }
+    return top == 1 && stack[0];
+}
+
+/*-----------------------------------------------------
+ * Subscription records
+ *
+ * One per ACAP_EVENTS_Subscribe*, registered by id in
+ * ACAP_EVENTS_SUBSCRIBERS and passed to axevent as callback context.
+ * Records are reference counted: the registry holds one reference and
+ * every event on its way to the callbacks holds another, so an
+ * unsubscribe never frees a record a queued event still points to.
+ *-----------------------------------------------------*/
+/* Gate state of one event stream (topic and source properties) */
+typedef struct {
+    guint64  value;             /* Value hash of the last event delivered or held */
+    int      seen;              /* value is set */
+    AXEvent* pending;           /* Held by debounce or coalesce, newest wins */
+    gint64   held_since;
+    gint64   last_arrival;
+} T_TopicGate;
+
+typedef struct {
+    guint                     id;
+    char*                     name;             /* Declaration "name", used by replay */
+    gpointer                  user_data;
+    ACAP_EVENTS_Callback      callback;         /* Per-subscription handlers; */
+    ACAP_EVENTS_View_Callback view_callback;    /* both NULL = global callbacks */
+    int                       refs;             /* Registry, events on their way, gate timer */
+    int                       closed;           /* Unsubscribed, deliver nothing more */
+    int                       gated;            /* Any option below is set */
+    int                       dedupe;           /* Drop events identical to the last one on their stream */
+    int                       coalesce;         /* Rate limit keeps the latest event instead of dropping */
+    gint64                    debounce_us;      /* Deliver once the stream has been quiet this long */
+    gint64                    interval_us;      /* Minimum time between deliveries (maxRatePerSec) */
+    pthread_mutex_t           lock;
+    guint                     timer;
+    int                       held;             /* Streams with a pending event */
+    gint64                    last_delivery;
+    T_Filter*                 filter;           /* Compiled "filter", NULL = every event */
+    T_EventStats              stats;
+    GHashTable*               topics;           /* Stream hash -> T_TopicGate, for dedupe/debounce/coalesce */
+} T_Subscription;
+
+static void subscription_release(T_Subscription* sub) {
+    if (__atomic_sub_fetch(&sub->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    if (sub->topics)
+        g_hash_table_destroy(sub->topics);
+    pthread_mutex_destroy(&sub->lock);
+    filter_free(sub->filter);
+    free(sub->name);
+    free(sub);
+}
+
+/* Deliver one event to the application and release it */
+static void
+ACAP_EVENTS_Process(T_Subscription* sub, AXEvent* axEvent) {
+    gpointer user_data = sub->user_data;
+    ACAP_EVENTS_Callback callback = EVENT_USER_CALLBACK;
+    ACAP_EVENTS_View_Callback viewCallback = EVENT_VIEW_CALLBACK;
+    /* Only ACAP_EVENTS_Subscribe treats user_data as cJSON, attached as the event's "source" */
+    int legacy = !sub->callback && !sub->view_callback;
+    if (!legacy) {
+        callback = sub->callback;
+        viewCallback = sub->view_callback;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    struct ACAP_Event_T view;
+    if (__atomic_load_n(&sub->closed, __ATOMIC_ACQUIRE) || !event_view_init(&view, axEvent)) {
+        ax_event_free(axEvent);
+        subscription_release(sub);
+        return;
+    }
+    history_record(&view, sub->id);
+    gint64 parsed = g_get_monotonic_time();
+    gint64 parse_us = parsed - start;
+    gint64 callback_us = 0;
+
+    if (viewCallback) {
+        viewCallback(&view, user_data);
+        gint64 now = g_get_monotonic_time();
+        callback_us += now - parsed;
+        parsed = now;
+    }
+
+    if (callback) {
+        /* Heap-allocated: the application may detach or keep parts of it */
+        cJSON* eventData = ACAP_EVENT_JSON(&view);
+        if (legacy && user_data)
+            cJSON_AddItemReferenceToObject(eventData, "source", (cJSON*)user_data);
+        gint64 built = g_get_monotonic_time();
+        parse_us += built - parsed;
+        callback(eventData, user_data);
+        callback_us += g_get_monotonic_time() - built;
+        cJSON_Delete(eventData);
+    }
+    event_view_clear(&view);
+    event_stats_delivered(&sub->stats, parse_us, callback_us);
+    ax_event_free(axEvent);
+    subscription_release(sub);
+}
+
+/*-----------------------------------------------------
+ * Event dispatch queue
+ *
+ * Optional hand-off between axevent delivery and the application
+ * callbacks. Events go into a bounded lock-free ring (Vyukov MPMC: each
+ * cell carries a sequence number, producers and consumers claim slots
+ * with one CAS) and are processed by worker threads or, with zero
+ * workers, in batches from a GLib idle source. Workers sleep on a
+ * semaphore; the BLOCK policy uses a second one counting free slots.
+ *-----------------------------------------------------*/
+#define DISPATCH_MAX_WORKERS  16
+#define DISPATCH_IDLE_BATCH   32
+
+typedef struct {
+    size_t          sequence;
+    AXEvent*        event;
+    T_Subscription* sub;
+} dispatch_cell_t;
+
+static struct {
+    int                  active;        /* Main callback enqueues instead of processing */
+    int                  workers;       /* 0 = GLib main loop */
+    int                  running;
+    ACAP_EVENTS_Overflow overflow;
+    dispatch_cell_t*     cells;
+    size_t               mask;
+    size_t               head __attribute__((aligned(64)));
+    size_t               tail __attribute__((aligned(64)));
+    sem_t                items;
+    sem_t                space;
+    int                  idle_scheduled;
+    pthread_t            threads[DISPATCH_MAX_WORKERS];
+    /* Counters, updated with relaxed atomics */
+    size_t               queued;
+    size_t               dispatched;
+    size_t               dropped;
+    size_t               blocked;
+    size_t               high_water;
+} dispatch;
+
+static int dispatch_push(AXEvent* event, T_Subscription* sub) {
+    size_t pos = __atomic_load_n(&dispatch.head, __ATOMIC_RELAXED);
+    dispatch_cell_t* cell;
+    for (;;) {
+        cell = &dispatch.cells[pos & dispatch.mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&dispatch.head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return 0;   /* Full */
+        } else {
+            pos = __atomic_load_n(&dispatch.head, __ATOMIC_RELAXED);
+        }
+    }
+    cell->event = event;
+    cell->sub = sub;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int dispatch_pop(dispatch_cell_t* out) {
+    size_t pos = __atomic_load_n(&dispatch.tail, __ATOMIC_RELAXED);
+    dispatch_cell_t* cell;
+    for (;;) {
+        cell = &dispatch.cells[pos & dispatch.mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&dispatch.tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return 0;   /* Empty */
+        } else {
+            pos = __atomic_load_n(&dispatch.tail, __ATOMIC_RELAXED);
+        }
+    }
+    *out = *cell;
+    __atomic_store_n(&cell->sequence, pos + dispatch.mask + 1, __ATOMIC_RELEASE);
+    if (dispatch.overflow == ACAP_EVENTS_BLOCK)
+        sem_post(&dispatch.space);
+    return 1;
+}
+
+static size_t dispatch_depth(void) {
+    size_t head = __atomic_load_n(&dispatch.head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&dispatch.tail, __ATOMIC_RELAXED);
+    return head > tail ? head - tail : 0;
+}
+
+static void dispatch_run(const dispatch_cell_t* cell) {
+    ACAP_EVENTS_Process(cell->sub, cell->event);
+    __atomic_add_fetch(&dispatch.dispatched, 1, __ATOMIC_RELAXED);
+}
+
+static gboolean dispatch_idle(gpointer data) {
+    dispatch_cell_t cell;
+    for (int i = 0; i < DISPATCH_IDLE_BATCH; i++) {
+        if (dispatch_pop(&cell)) {
+            dispatch_run(&cell);
+            continue;
+        }
+        /* Empty: unschedule, then re-check for a push that saw us scheduled */
+        __atomic_store_n(&dispatch.idle_scheduled, 0, __ATOMIC_SEQ_CST);
+        if (dispatch_depth() && !__atomic_exchange_n(&dispatch.idle_scheduled, 1, __ATOMIC_SEQ_CST))
+            continue;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void* dispatch_worker(void* arg) {
+    dispatch_cell_t cell;
+    for (;;) {
+        while (sem_wait(&dispatch.items) != 0 && errno == EINTR)
+            ;
+        if (dispatch_pop(&cell))
+            dispatch_run(&cell);
+        else if (!__atomic_load_n(&dispatch.running, __ATOMIC_ACQUIRE))
+            break;
+    }
+    cJSON_ReleaseThreadBuffers();
+    return NULL;
+}
+
+static void dispatch_enqueue(T_Subscription* sub, AXEvent* axEvent) {
+    if (dispatch.overflow == ACAP_EVENTS_BLOCK && sem_trywait(&dispatch.space) != 0) {
+        __atomic_add_fetch(&dispatch.blocked, 1, __ATOMIC_RELAXED);
+        while (sem_wait(&dispatch.space) != 0 && errno == EINTR)
+            ;
+    }
+
+    dispatch_cell_t oldest;
+    while (!dispatch_push(axEvent, sub)) {
+        if (dispatch.overflow == ACAP_EVENTS_DROP_NEWEST) {
+            __atomic_add_fetch(&dispatch.dropped, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&sub->stats.dropped, 1, __ATOMIC_RELAXED);
+            ax_event_free(axEvent);
+            subscription_release(sub);
+            return;
+        }
+        if (dispatch_pop(&oldest)) {
+            __atomic_add_fetch(&dispatch.dropped, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&oldest.sub->stats.dropped, 1, __ATOMIC_RELAXED);
+            ax_event_free(oldest.event);
+            subscription_release(oldest.sub);
+        }
+    }
+    __atomic_add_fetch(&dispatch.queued, 1, __ATOMIC_RELAXED);
+
+    size_t depth = dispatch_depth();
+    size_t high = __atomic_load_n(&dispatch.high_water, __ATOMIC_RELAXED);
+    while (depth > high &&
+           !__atomic_compare_exchange_n(&dispatch.high_water, &high, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    if (dispatch.workers > 0)
+        sem_post(&dispatch.items);
+    else if (!__atomic_exchange_n(&dispatch.idle_scheduled, 1, __ATOMIC_SEQ_CST))
+        g_idle_add(dispatch_idle, &dispatch);
+}
+
+/* Stop workers and empty the ring, delivering or discarding what is left */
+static void dispatch_stop(int deliver) {
+    if (!dispatch.cells)
+        return;
+    __atomic_store_n(&dispatch.active, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&dispatch.running, 0, __ATOMIC_RELEASE);
+    for (int i = 0; i < dispatch.workers; i++)
+        sem_post(&dispatch.items);
+    for (int i = 0; i < dispatch.workers; i++)
+        pthread_join(dispatch.threads[i], NULL);
+    if (dispatch.workers == 0 && __atomic_load_n(&dispatch.idle_scheduled, __ATOMIC_SEQ_CST))
+        g_idle_remove_by_data(&dispatch);
+
+    dispatch_cell_t cell;
+    while (dispatch_pop(&cell)) {
+        if (deliver) {
+            dispatch_run(&cell);
+        } else {
+            ax_event_free(cell.event);
+            subscription_release(cell.sub);
+        }
+    }
+    sem_destroy(&dispatch.items);
+    sem_destroy(&dispatch.space);
+    free(dispatch.cells);
+    memset(&dispatch, 0, sizeof(dispatch));
+}
+
+static const char* dispatch_overflow_name(ACAP_EVENTS_Overflow overflow) {
+    switch (overflow) {
+        case ACAP_EVENTS_DROP_NEWEST: return "drop-newest";
+        case ACAP_EVENTS_BLOCK:       return "block";
+        default:                      return "drop-oldest";
+    }
+}
+
+int ACAP_EVENTS_SetDispatch(int workers, int capacity, ACAP_EVENTS_Overflow overflow) {
+    LOG_TRACE("%s: workers=%d capacity=%d\n", __func__, workers, capacity);
+
+    dispatch_stop(1);
+    if (workers < 0)
+        return 1;   /* Synchronous delivery */
+
+    if (workers > DISPATCH_MAX_WORKERS) {
+        LOG_WARN("%s: Limiting workers to %d\n", __func__, DISPATCH_MAX_WORKERS);
+        workers = DISPATCH_MAX_WORKERS;
+    }
+    if (workers == 0 && overflow == ACAP_EVENTS_BLOCK) {
+        /* Events arrive on the main loop; blocking it would stop the consumer too */
+        LOG_WARN("%s: block policy needs workers, using drop-oldest\n", __func__);
+        overflow = ACAP_EVENTS_DROP_OLDEST;
+    }
+
+    size_t size = 2;
+    while (size < (size_t)(capacity > 0 ? capacity : 1))
+        size <<= 1;
+    dispatch.cells = calloc(size, sizeof(dispatch_cell_t));
+    if (!dispatch.cells) {
+        LOG_WARN("%s: Unable to allocate queue\n", __func__);
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++)
+        dispatch.cells[i].sequence = i;
+    dispatch.mask = size - 1;
+    dispatch.overflow = overflow;
+    dispatch.workers = workers;
+    dispatch.running = 1;
+    sem_init(&dispatch.items, 0, 0);
+    sem_init(&dispatch.space, 0, (unsigned)size);
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&dispatch.threads[i], NULL, dispatch_worker, NULL) != 0) {
+            LOG_WARN("%s: Unable to start worker %d\n", __func__, i);
+            dispatch.workers = i;
+            break;
+        }
+    }
+    if (workers > 0 && dispatch.workers == 0) {
+        dispatch_stop(0);
+        return 0;
+    }
+    __atomic_store_n(&dispatch.active, 1, __ATOMIC_SEQ_CST);
+    LOG("Event dispatch: %s (%d workers), queue %zu, %s\n", dispatch.workers ? "threads" : "main loop",
+        dispatch.workers, size, dispatch_overflow_name(overflow));
+    return 1;
+}
+
+/* Called before the status tree is served */
+static void events_status_refresh(void) {
+    if (!dispatch.cells)
+        return;
+    ACAP_STATUS_SetString("eventQueue", "mode", dispatch.workers ? "workers" : "mainloop");
+    ACAP_STATUS_SetString("eventQueue", "overflow", dispatch_overflow_name(dispatch.overflow));
+    ACAP_STATUS_SetNumber("eventQueue", "workers", dispatch.workers);
+    ACAP_STATUS_SetNumber("eventQueue", "capacity", dispatch.mask + 1);
+    ACAP_STATUS_SetNumber("eventQueue", "depth", dispatch_depth());
+    ACAP_STATUS_SetNumber("eventQueue", "highWater", __atomic_load_n(&dispatch.high_water, __ATOMIC_RELAXED));
+    ACAP_STATUS_SetNumber("eventQueue", "queued", __atomic_load_n(&dispatch.queued, __ATOMIC_RELAXED));
+    ACAP_STATUS_SetNumber("eventQueue", "dispatched", __atomic_load_n(&dispatch.dispatched, __ATOMIC_RELAXED));
+    ACAP_STATUS_SetNumber("eventQueue", "dropped", __atomic_load_n(&dispatch.dropped, __ATOMIC_RELAXED));
+    ACAP_STATUS_SetNumber("eventQueue", "blocked", __atomic_load_n(&dispatch.blocked, __ATOMIC_RELAXED));
+}
+
+/*-----------------------------------------------------
+ * Subscription gate: dedupe, debounce and rate limit
+ *
+ * Options from the subscription declaration are applied in the axevent
+ * callback, before the event is queued or decoded. Dedupe, debounce and
+ * coalescing work per stream (topic plus source properties), each with
+ * its own "pending" slot; the rate limit is per subscription. Held events
+ * are released by one GLib timeout, which holds a subscription reference.
+ *-----------------------------------------------------*/
+static void event_deliver(T_Subscription* sub, AXEvent* axEvent) {
+    __atomic_add_fetch(&sub->refs, 1, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&dispatch.active, __ATOMIC_ACQUIRE))
+        dispatch_enqueue(sub, axEvent);
+    else
+        ACAP_EVENTS_Process(sub, axEvent);
+}
+
+static guint64 event_hash_mix(guint64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+static guint64 event_hash_string(const char* s) {
+    guint64 h = 0xcbf29ce484222325ULL;
+    while (s && *s)
+        h = (h ^ (unsigned char)*s++) * 0x100000001b3ULL;
+    return h;
+}
+
+/*
+ * Entries are summed so the hash does not depend on hash table order. When the event marks
+ * its data properties, the source properties (e.g. the I/O port) are part of the stream hash,
+ * so each source on a wildcard subscription is deduplicated and held on its own.
+ */
+static void event_set_hash(const T_ValueSet* set, guint64* topic_hash, guint64* value_hash) {
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value;
+    guint64 source_hash = 0, data_hash = 0;
+    int marked = 0;
+    *topic_hash = 0;
+    *value_hash = 0;
+    g_hash_table_iter_init(&iter, set->key_values);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value)) {
+        guint64 key = event_hash_string(nskp->key);
+        if (event_topic_level(nskp->key) >= 0) {
+            *topic_hash += event_hash_mix(key ^ event_hash_string(value->str_value));
+            continue;
+        }
+        guint64 v = 0;
+        if (value->defined) {
+            switch (value->value_type) {
+                case AX_VALUE_TYPE_INT:     v = (guint64)(gint64)value->int_value; break;
+                case AX_VALUE_TYPE_BOOL:    v = value->bool_value ? 1 : 0; break;
+                case AX_VALUE_TYPE_DOUBLE:  memcpy(&v, &value->double_value, sizeof(v)); break;
+                case AX_VALUE_TYPE_STRING:  v = event_hash_string(value->str_value); break;
+                case AX_VALUE_TYPE_ELEMENT: v = event_hash_string(value->elem_str_value); break;
+                default: break;
+            }
+            v = event_hash_mix(v + (guint64)value->value_type + 1);
+        }
+        v = event_hash_mix(key ^ v);
+        *value_hash += v;
+        if (value->onvif_data) {
+            marked = 1;
+            data_hash += v;
+        } else {
+            source_hash += v;
+        }
+    }
+    if (marked) {
+        *topic_hash += event_hash_mix(source_hash);
+        *value_hash = data_hash;
+    }
+}
+
+/* Stream and value hashes of an event; returns 0 when it carries no key/value set */
+static int subscription_hash(AXEvent* axEvent, guint64* topic, guint64* value) {
+    const T_ValueSet* set = (const T_ValueSet*)ax_event_get_key_value_set(axEvent);
+    if (!set || !set->key_values)
+        return 0;
+    event_set_hash(set, topic, value);
+    return 1;
+}
+
+/* Gate state of one stream, created on its first event; call with the lock held */
+static T_TopicGate* subscription_topic(T_Subscription* sub, guint64 topic) {
+    gpointer key = GSIZE_TO_POINTER((gsize)topic);
+    T_TopicGate* gate = g_hash_table_lookup(sub->topics, key);
+    if (!gate) {
+        gate = g_new0(T_TopicGate, 1);
+        g_hash_table_insert(sub->topics, key, gate);
+    }
+    return gate;
+}
+
+static gboolean subscription_timer(gpointer data);
+
+/* The timer holds a reference, released when its source is destroyed */
+static void subscription_timer_done(gpointer data) {
+    subscription_release(data);
+}
+
+static void subscription_schedule(T_Subscription* sub, gint64 due, gint64 now) {
+    if (sub->timer)
+        return;
+    gint64 wait_ms = due > now ? (due - now + 999) / 1000 : 0;
+    __atomic_add_fetch(&sub->refs, 1, __ATOMIC_RELAXED);
+    sub->timer = g_timeout_add_full(G_PRIORITY_DEFAULT, (guint)wait_ms, subscription_timer, sub, subscription_timer_done);
+}
+
+/* Earliest time the stream's held event may go out; call with the lock held */
+static gint64 subscription_due(const T_Subscription* sub, const T_TopicGate* gate) {
+    gint64 due = gate->last_arrival + sub->debounce_us;
+    if (sub->interval_us && sub->last_delivery + sub->interval_us > due)
+        due = sub->last_delivery + sub->interval_us;
+    return due;
+}
+
+/* Release held events that are due; the rate limit lets the longest held go first */
+static gboolean subscription_timer(gpointer data) {
+    T_Subscription* sub = data;
+    gint64 now = g_get_monotonic_time();
+    GSList* ready = NULL;
+    GHashTableIter iter;
+    T_TopicGate* gate;
+
+    pthread_mutex_lock(&sub->lock);
+    sub->timer = 0;
+    if (__atomic_load_n(&sub->closed, __ATOMIC_ACQUIRE) || !sub->held) {
+        pthread_mutex_unlock(&sub->lock);
+        return G_SOURCE_REMOVE;
+    }
+    T_TopicGate* first = NULL;
+    g_hash_table_iter_init(&iter, sub->topics);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&gate)) {
+        if (!gate->pending || subscription_due(sub, gate) > now)
+            continue;
+        if (sub->interval_us) {
+            if (!first || gate->held_since < first->held_since)
+                first = gate;
+            continue;
+        }
+        ready = g_slist_prepend(ready, gate->pending);
+        gate->pending = NULL;
+        sub->held--;
+    }
+    if (first) {
+        ready = g_slist_prepend(ready, first->pending);
+        first->pending = NULL;
+        sub->held--;
+    }
+    if (ready)
+        sub->last_delivery = now;
+
+    gint64 next = 0;
+    g_hash_table_iter_init(&iter, sub->topics);
+    while (sub->held && g_hash_table_iter_next(&iter, NULL, (gpointer*)&gate)) {
+        gint64 due = gate->pending ? subscription_due(sub, gate) : 0;
+        if (gate->pending && (!next || due < next))
+            next = due;
+    }
+    if (sub->held)
+        subscription_schedule(sub, next, now);
+    pthread_mutex_unlock(&sub->lock);
+
+    for (GSList* item = ready; item; item = item->next)
+        event_deliver(sub, item->data);
+    g_slist_free(ready);
+    return G_SOURCE_REMOVE;
+}
+
+static void subscription_gate(T_Subscription* sub, AXEvent* axEvent) {
+    gint64 now = g_get_monotonic_time();
+    AXEvent* dropped = NULL;
+    guint64 topic = 0, value = 0;
+    int hashed = sub->topics && subscription_hash(axEvent, &topic, &value);
+
+    pthread_mutex_lock(&sub->lock);
+    T_TopicGate* gate = sub->topics ? subscription_topic(sub, topic) : NULL;
+    if (gate)
+        gate->last_arrival = now;   /* Repeats keep a debounce window open too */
+    if (hashed && sub->dedupe && gate->seen && gate->value == value) {
+        pthread_mutex_unlock(&sub->lock);
+        __atomic_add_fetch(&sub->stats.dropped, 1, __ATOMIC_RELAXED);
+        ax_event_free(axEvent);
+        return;
+    }
+
+    /* Values are remembered only for events delivered or held, so a dropped transition is seen again */
+    if (!sub->debounce_us && (!sub->interval_us || now - sub->last_delivery >= sub->interval_us) && !sub->held) {
+        sub->last_delivery = now;
+        if (hashed) {
+            gate->value = value;
+            gate->seen = 1;
+        }
+        pthread_mutex_unlock(&sub->lock);
+        event_deliver(sub, axEvent);
+        return;
+    }
+
+    if (sub->debounce_us || sub->coalesce) {
+        /* Hold the newest event of the stream; the one it replaces is never delivered */
+        dropped = gate->pending;
+        gate->pending = axEvent;
+        if (!dropped) {
+            gate->held_since = now;
+            sub->held++;
+        }
+        if (hashed) {
+            gate->value = value;
+            gate->seen = 1;
+        }
+        subscription_schedule(sub, subscription_due(sub, gate), now);
+        if (dropped)
+            __atomic_add_fetch(&sub->stats.coalesced, 1, __ATOMIC_RELAXED);
+    } else {
+        dropped = axEvent;
+        __atomic_add_fetch(&sub->stats.dropped, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&sub->lock);
+
+    if (dropped)
+        ax_event_free(dropped);
+}
+
+/* Options override the same keys in the declaration */
+static cJSON* subscription_option(cJSON* declaration, cJSON* options, const char* name) {
+    cJSON* item = options ? cJSON_GetObjectItem(options, name) : NULL;
+    return item ? item : cJSON_GetObjectItem(declaration, name);
+}
+
+static T_Subscription* subscription_new(cJSON* declaration, cJSON* options, gpointer user_data) {
+    T_Subscription* sub = calloc(1, sizeof(T_Subscription));
+    if (!sub)
+        return NULL;
+    sub->user_data = user_data;
+    sub->refs = 1;
+    pthread_mutex_init(&sub->lock, NULL);
+    cJSON* name = cJSON_GetObjectItem(declaration, "name");
+    if (cJSON_IsString(name))
+        sub->name = strdup(name->valuestring);
+
+    cJSON* debounce = subscription_option(declaration, options, "debounceMs");
+    if (cJSON_IsNumber(debounce) && debounce->valuedouble > 0)
+        sub->debounce_us = (gint64)(debounce->valuedouble * 1000);
+    cJSON* rate = subscription_option(declaration, options, "maxRatePerSec");
+    if (cJSON_IsNumber(rate) && rate->valuedouble > 0)
+        sub->interval_us = (gint64)(1000000.0 / rate->valuedouble);
+    cJSON* coalesce = subscription_option(declaration, options, "coalesce");
+    if (cJSON_IsString(coalesce) && strcmp(coalesce->valuestring, "latest") == 0)
+        sub->coalesce = 1;
+    else if (coalesce)
+        LOG_WARN("%s: Unsupported coalesce mode, expected \"latest\"\n", __func__);
+    sub->dedupe = cJSON_IsTrue(subscription_option(declaration, options, "dedupe"));
+    cJSON* filter = subscription_option(declaration, options, "filter");
+    if (cJSON_IsString(filter) && filter->valuestring[0]) {
+        sub->filter = filter_compile(filter->valuestring);
+        if (!sub->filter) {
+            subscription_release(sub);
+            return NULL;
+        }
+    }
+    sub->last_delivery = g_get_monotonic_time() - sub->interval_us;  /* First event passes */
+
+    if (sub->dedupe || sub->debounce_us || sub->coalesce)
+        sub->topics = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    sub->gated = sub->dedupe || sub->coalesce || sub->debounce_us || sub->interval_us;
+    return sub;
+}
+
+/* Registry value destructor: stop the gate and drop the registry reference */
+static void subscription_close(gpointer data) {
+    T_Subscription* sub = data;
+    if (!sub)
+        return;
+    __atomic_store_n(&sub->closed, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&sub->lock);
+    if (sub->timer)
+        g_source_remove(sub->timer);
+    sub->timer = 0;
+    if (sub->topics) {
+        GHashTableIter iter;
+        T_TopicGate* gate;
+        g_hash_table_iter_init(&iter, sub->topics);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&gate)) {
+            if (gate->pending)
+                ax_event_free(gate->pending);
+            gate->pending = NULL;
+        }
+    }
+    sub->held = 0;
+    pthread_mutex_unlock(&sub->lock);
+    subscription_release(sub);
+}
+
+/*-----------------------------------------------------
+ * Event recorder and replay
+ *
+ * Recording appends every event that reaches the subscription callback,
+ * before dedupe/rate limiting, to a binary file. Replay rebuilds the
+ * events with the SDK key-value API and feeds them through the same
+ * path (gate, dispatch queue, callbacks), so no event daemon or
+ * subscription to a live topic is needed.
+ *
+ * File: "ACAPEVT1", then per event (little-endian):
+ *   u32 size of the rest of the record
+ *   u64 microseconds since recording started
+ *   u8  name length, subscription name
+ *   u16 entry count, entries:
+ *       u8 type (AXEventValueType, 0xFF = undefined)
+ *       u8 namespace length, namespace, u8 key length, key
+ *       value: i32 int, u8 bool, f64 double, u16 length + bytes string
+ *-----------------------------------------------------*/
+#define RECORD_MAGIC      "ACAPEVT1"
+#define RECORD_UNDEFINED  0xFF
+
+static struct {
+    FILE*           file;
+    pthread_mutex_t lock;
+    gint64          start;
+    unsigned char*  buffer;
+    size_t          size;
+    size_t          length;
+    size_t          events;
+} recorder = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* Append to the record buffer; returns 0 when it cannot grow */
+static int record_put(const void* data, size_t length) {
+    if (recorder.length + length > recorder.size) {
+        size_t size = recorder.size ? recorder.size : 1024;
+        while (size < recorder.length + length)
+            size *= 2;
+        unsigned char* buffer = realloc(recorder.buffer, size);
+        if (!buffer)
+            return 0;
+        recorder.buffer = buffer;
+        recorder.size = size;
+    }
+    memcpy(recorder.buffer + recorder.length, data, length);
+    recorder.length += length;
+    return 1;
+}
+
+static int record_put_uint(guint64 value, int bytes) {
+    unsigned char le[8];
+    for (int i = 0; i < bytes; i++)
+        le[i] = (unsigned char)(value >> (8 * i));
+    return record_put(le, bytes);
+}
+
+static int record_put_text(const char* text, int width) {
+    size_t max = width == 1 ? 0xFF : 0xFFFF;
+    size_t length = text ? strlen(text) : 0;
+    if (length > max)
+        length = max;
+    if (!record_put_uint(length, width))
+        return 0;
+    return length ? record_put(text, length) : 1;
+}
+
+static void event_record(const T_Subscription* sub, AXEvent* axEvent) {
+    const T_ValueSet* set = (const T_ValueSet*)ax_event_get_key_value_set(axEvent);
+    if (!set || !set->key_values)
+        return;
+    gint64 now = g_get_monotonic_time();
+
+    pthread_mutex_lock(&recorder.lock);
+    if (!recorder.file) {
+        pthread_mutex_unlock(&recorder.lock);
+        return;
+    }
+    recorder.length = 0;
+    int ok = record_put_uint(0, 4);  /* Size, patched below */
+    ok = ok && record_put_uint((guint64)(now - recorder.start), 8);
+    ok = ok && record_put_text(sub->name, 1);
+    ok = ok && record_put_uint(g_hash_table_size(set->key_values), 2);
+
+    GHashTableIter iter;
+    T_KeyPair* nskp;
+    T_ValueElement* value;
+    g_hash_table_iter_init(&iter, set->key_values);
+    while (ok && g_hash_table_iter_next(&iter, (gpointer*)&nskp, (gpointer*)&value)) {
+        int type = value->defined ? (int)value->value_type : RECORD_UNDEFINED;
+        if (type == AX_VALUE_TYPE_ELEMENT)
+            type = AX_VALUE_TYPE_STRING;
+        ok = record_put_uint(type, 1) &&
+             record_put_text(nskp->name_space, 1) &&
+             record_put_text(nskp->key, 1);
+        switch (ok ? type : RECORD_UNDEFINED) {
+            case AX_VALUE_TYPE_INT:    ok = record_put_uint((guint32)value->int_value, 4); break;
+            case AX_VALUE_TYPE_BOOL:   ok = record_put_uint(value->bool_value ? 1 : 0, 1); break;
+            case AX_VALUE_TYPE_DOUBLE: {
+                guint64 bits;
+                memcpy(&bits, &value->double_value, sizeof(bits));
+                ok = record_put_uint(bits, 8);
+                break;
+            }
+            case AX_VALUE_TYPE_STRING:
+                ok = record_put_text(value->value_type == AX_VALUE_TYPE_ELEMENT ? value->elem_str_value : value->str_value, 2);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!ok) {
+        /* A partial record would corrupt the file; skip the event */
+        pthread_mutex_unlock(&recorder.lock);
+        LOG_WARN("%s: Out of memory, event not recorded\n", __func__);
+        return;
+    }
+    for (int i = 0; i < 4; i++)
+        recorder.buffer[i] = (unsigned char)((recorder.length - 4) >> (8 * i));
+    if (fwrite(recorder.buffer, 1, recorder.length, recorder.file) == recorder.length)
+        recorder.events++;
+    pthread_mutex_unlock(&recorder.lock);
+}
+
+static FILE* record_open(const char* path, const char* mode) {
+    return path[0] == '/' ? fopen(path, mode) : ACAP_FILE_Open(path, mode);
+}
+
+static guint64 record_last_offset(FILE* file, long size, long* end);
+
+int ACAP_EVENTS_Record(const char* path) {
+    pthread_mutex_lock(&recorder.lock);
+    if (recorder.file) {
+        fclose(recorder.file);
+        LOG("Event recording stopped, %zu events\n", recorder.events);
+        recorder.file = NULL;
+    }
+    free(recorder.buffer);
+    recorder.buffer = NULL;
+    recorder.size = 0;
+    if (!path) {
+        pthread_mutex_unlock(&recorder.lock);
+        return 1;
+    }
+
+    FILE* file = record_open(path, "a+b");
+    if (!file) {
+        pthread_mutex_unlock(&recorder.lock);
+        LOG_WARN("%s: Unable to open %s: %s\n", __func__, path, strerror(errno));
+        return 0;
+    }
+    /* Appending to an existing recording continues its time line after the last event */
+    guint64 offset = 0;
+    long end = 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    if (size > 0)
+        offset = record_last_offset(file, size, &end);
+    if (end < 0) {
+        fclose(file);
+        pthread_mutex_unlock(&recorder.lock);
+        LOG_WARN("%s: %s is not an event recording\n", __func__, path);
+        return 0;
+    }
+    if (end < size) {
+        /* Drop a record torn by a crash or full disk, or new records would be unreadable after it */
+        LOG_WARN("%s: Truncating %ld bytes of incomplete data in %s\n", __func__, size - end, path);
+        if (ftruncate(fileno(file), end) != 0) {
+            int error = errno;
+            fclose(file);
+            pthread_mutex_unlock(&recorder.lock);
+            LOG_WARN("%s: Unable to truncate %s: %s\n", __func__, path, strerror(error));
+            return 0;
+        }
+    }
+    fseek(file, 0, SEEK_END);
+    if (end == 0)
+        fwrite(RECORD_MAGIC, 1, strlen(RECORD_MAGIC), file);
+    recorder.start = g_get_monotonic_time() - (gint64)offset;
+    recorder.events = 0;
+    recorder.file = file;
+    pthread_mutex_unlock(&recorder.lock);
+    LOG("Recording events to %s\n", path);
+    return 1;
+}
+
+typedef struct {
+    const unsigned char* data;
+    size_t length;
+    size_t offset;
+} T_RecordReader;
+
+static int record_get(T_RecordReader* reader, void* out, size_t length) {
+    if (reader->offset + length > reader->length)
+        return 0;
+    if (out)
+        memcpy(out, reader->data + reader->offset, length);
+    reader->offset += length;
+    return 1;
+}
+
+static int record_get_uint(T_RecordReader* reader, guint64* value, int bytes) {
+    unsigned char le[8];
+    if (!record_get(reader, le, bytes))
+        return 0;
+    *value = 0;
+    for (int i = 0; i < bytes; i++)
+        *value |= (guint64)le[i] << (8 * i);
+    return 1;
+}
+
+/*
+ * Time offset of the last complete record in a recording of size bytes, 0 if none.
+ * end is set to the byte after that record, 0 when even the magic is incomplete,
+ * or -1 when the file is not a recording.
+ */
+static guint64 record_last_offset(FILE* file, long size, long* end) {
+    guint64 last = 0;
+    long position = (long)strlen(RECORD_MAGIC);
+    size_t prefix = size < position ? (size_t)size : (size_t)position;
+    char magic[sizeof(RECORD_MAGIC)];
+    unsigned char header[12];
+    *end = -1;
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(magic, 1, prefix, file) != prefix ||
+        memcmp(magic, RECORD_MAGIC, prefix) != 0)
+        return 0;
+    *end = 0;
+    if (size < position)
+        return 0;
+    *end = position;
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        T_RecordReader reader = { header, sizeof(header), 0 };
+        guint64 length, timestamp;
+        record_get_uint(&reader, &length, 4);
+        record_get_uint(&reader, &timestamp, 8);
+        if (length < 8 || (guint64)(size - position) < 4 + length)
+            break;
+        position += 4 + (long)length;
+        if (fseek(file, position, SEEK_SET) != 0)
+            break;
+        last = timestamp;
+        *end = position;
+    }
+    return last;
+}
+
+/* Copy a length-prefixed string into text (NUL-terminated) */
+static int record_get_text(T_RecordReader* reader, char* text, size_t size, int width) {
+    guint64 length;
+    if (!record_get_uint(reader, &length, width) || length >= size)
+        return 0;
+    if (!record_get(reader, text, length))
+        return 0;
+    text[length] = '\0';
+    return 1;
+}
+
+static AXEvent* record_decode(T_RecordReader* reader, char* name, size_t nameSize) {
+    guint64 count;
+    if (!record_get_text(reader, name, nameSize, 1) || !record_get_uint(reader, &count, 2))
+        return NULL;
+
+    AXEventKeyValueSet* set = ax_event_key_value_set_new();
+    char space[256], key[256], text[65536];
+    int ok = 1;
+    for (guint64 i = 0; ok && i < count; i++) {
+        guint64 type, raw;
+        ok = record_get_uint(reader, &type, 1) &&
+             record_get_text(reader, space, sizeof(space), 1) &&
+             record_get_text(reader, key, sizeof(key), 1);
+        if (!ok)
+            break;
+        const char* ns = space[0] ? space : NULL;
+        switch ((int)type) {
+            case AX_VALUE_TYPE_INT: {
+                ok = record_get_uint(reader, &raw, 4);
+                int value = (int)(guint32)raw;
+                ok = ok && ax_event_key_value_set_add_key_value(set, key, ns, &value, AX_VALUE_TYPE_INT, NULL);
+                break;
+            }
+            case AX_VALUE_TYPE_BOOL: {
+                ok = record_get_uint(reader, &raw, 1);
+                int value = raw ? 1 : 0;
+                ok = ok && ax_event_key_value_set_add_key_value(set, key, ns, &value, AX_VALUE_TYPE_BOOL, NULL);
+                break;
+            }
+            case AX_VALUE_TYPE_DOUBLE: {
+                double value;
+                ok = record_get_uint(reader, &raw, 8);
+                memcpy(&value, &raw, sizeof(value));
+                ok = ok && ax_event_key_value_set_add_key_value(set, key, ns, &value, AX_VALUE_TYPE_DOUBLE, NULL);
+                break;
+            }
+            case AX_VALUE_TYPE_STRING:
+                ok = record_get_text(reader, text, sizeof(text), 2) &&
+                     ax_event_key_value_set_add_key_value(set, key, ns, text, AX_VALUE_TYPE_STRING, NULL);
+                break;
+            default:
+                ax_event_key_value_set_add_key_value(set, key, ns, NULL, AX_VALUE_TYPE_STRING, NULL);
+                break;
+        }
+    }
+    AXEvent* axEvent = ok ? ax_event_new2(set, NULL) : NULL;
+    ax_event_key_value_set_free(set);
+    return axEvent;
+}
+
+static void events_receive(T_Subscription* sub, AXEvent* axEvent);
+
+int ACAP_EVENTS_Replay(const char* path, double speed) {
+    if (!path) {
+        LOG_WARN("%s: Invalid path\n", __func__);
+        return 0;
+    }
+    FILE* file = record_open(path, "rb");
+    if (!file) {
+        LOG_WARN("%s: Unable to open %s: %s\n", __func__, path, strerror(errno));
+        return 0;
+    }
+    char magic[sizeof(RECORD_MAGIC) - 1];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0) {
+        LOG_WARN("%s: %s is not an event recording\n", __func__, path);
+        fclose(file);
+        return 0;
+    }
+
+    /* Events go to the subscription with the recorded name, or to the
+       global callbacks when no such subscription exists */
+    T_Subscription* fallback = calloc(1, sizeof(T_Subscription));
+    if (!fallback) {
+        fclose(file);
+        return 0;
+    }
+    fallback->refs = 1;
+    pthread_mutex_init(&fallback->lock, NULL);
+
+    gint64 start = g_get_monotonic_time();
+    gint64 first = -1;
+    int count = 0;
+    unsigned char* data = NULL;
+    size_t dataSize = 0;
+    char name[256];
+    unsigned char header[12];
+
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        T_RecordReader reader = { header, sizeof(header), 0 };
+        guint64 size, timestamp;
+        record_get_uint(&reader, &size, 4);
+        record_get_uint(&reader, &timestamp, 8);
+        if (size < 8)
+            break;
+        size -= 8;
+        if (size > dataSize) {
+            unsigned char* grown = realloc(data, size);
+            if (!grown)
+                break;
+            data = grown;
+            dataSize = size;
+        }
+        if (fread(data, 1, size, file) != size)
+            break;
+
+        reader = (T_RecordReader){ data, size, 0 };
+        AXEvent* axEvent = record_decode(&reader, name, sizeof(name));
+        if (!axEvent) {
+            LOG_WARN("%s: Corrupt record %d in %s\n", __func__, count, path);
+            break;
+        }
+
+        if (first < 0)
+            first = (gint64)timestamp;
+        if (speed > 0) {
+            gint64 due = start + (gint64)(((gint64)timestamp - first) / speed);
+            gint64 now = g_get_monotonic_time();
+            if (due > now)
+                g_usleep((gulong)(due - now));
+        }
+
+        T_Subscription* sub = NULL;
+        if (ACAP_EVENTS_SUBSCRIBERS) {
+            GHashTableIter iter;
+            T_Subscription* candidate;
+            g_hash_table_iter_init(&iter, ACAP_EVENTS_SUBSCRIBERS);
+            while (!sub && g_hash_table_iter_next(&iter, NULL, (gpointer*)&candidate))
+                if (candidate->name && strcmp(candidate->name, name) == 0)
+                    sub = candidate;
+        }
+        sub = sub ? sub : fallback;
+        __atomic_add_fetch(&sub->refs, 1, __ATOMIC_RELAXED);
+        events_receive(sub, axEvent);
+        subscription_release(sub);
+        count++;
+    }
+    free(data);
+    fclose(file);
+
+    /* Events still in the dispatch queue keep the fallback alive */
+    subscription_release(fallback);
+    LOG("%s: %d events from %s in %.1f ms\n", __func__, count, path,
+        (g_get_monotonic_time() - start) / 1000.0);
+    return count;
+}
+
+static void events_receive(T_Subscription* sub, AXEvent* axEvent) {
+    __atomic_add_fetch(&sub->stats.received, 1, __ATOMIC_RELAXED);
+    if (sub->filter && !filter_match(sub->filter, axEvent)) {
+        __atomic_add_fetch(&sub->stats.filtered, 1, __ATOMIC_RELAXED);
+        ax_event_free(axEvent);
+        return;
+    }
+    if (sub->gated)
+        subscription_gate(sub, axEvent);
+    else
+        event_deliver(sub, axEvent);
+}
+
+static void
+ACAP_EVENTS_Main_Callback(guint subscription, AXEvent* axEvent, gpointer user_data) {
+    LOG_TRACE("%s:\n", __func__);
+
+    T_Subscription* sub = user_data;
+    if (__atomic_load_n(&recorder.file, __ATOMIC_RELAXED))
+        event_record(sub, axEvent);
+    events_receive(sub, axEvent);
+}
+
+/*-----------------------------------------------------
  * Event subscription helper — adds one topic level to keyset
  *-----------------------------------------------------*/
 static int add_subscribe_topic(AXEventKeyValueSet* keyset, cJSON* event, const char* topicKey) {
@@ -1692,7 +4231,8 @@ static int add_subscribe_topic(AXEventKeyValueSet* keyset, cJSON* event, const c
     return 1;
 }
 
-int ACAP_EVENTS_Subscribe(cJSON* event, void* user_data) {
+static int events_subscribe(cJSON* event, cJSON* options, ACAP_EVENTS_Callback callback,
+                            ACAP_EVENTS_View_Callback viewCallback, void* user_data) {
     guint declarationID = 0;
 
     if (!ACAP_EVENTS_HANDLER) {
@@ -1729,61 +4269,359 @@ int ACAP_EVENTS_Subscribe(cJSON* event, void* user_data) {
         }
     }
 
+    T_Subscription* sub = subscription_new(event, options, user_data);
+    if (!sub) {
+        ax_event_key_value_set_free(keyset);
+        return 0;
+    }
+    sub->callback = callback;
+    sub->view_callback = viewCallback;
+
     int ax = ax_event_handler_subscribe(
         ACAP_EVENTS_HANDLER,
         keyset,
         &declarationID,
         ACAP_EVENTS_Main_Callback,
-        (gpointer)user_data,
+        (gpointer)sub,
         NULL
     );
 
     ax_event_key_value_set_free(keyset);
     if (!ax) {
         LOG_WARN("ACAP_EVENTS_Subscribe: Unable to subscribe to event\n");
+        subscription_close(sub);
         return 0;
     }
-    cJSON_AddItemToArray(ACAP_EVENTS_SUBSCRIPTIONS, cJSON_CreateNumber(declarationID));
+    sub->id = declarationID;
+    g_hash_table_insert(ACAP_EVENTS_SUBSCRIBERS, GUINT_TO_POINTER(declarationID), sub);
     return declarationID;
 }
 
+int ACAP_EVENTS_Subscribe(cJSON* event, void* user_data) {
+    return events_subscribe(event, NULL, NULL, NULL, user_data);
+}
+
+int ACAP_EVENTS_Subscribe_With(cJSON* event, ACAP_EVENTS_Callback callback, void* user_data, cJSON* options) {
+    if (!callback) {
+        LOG_WARN("%s: Missing callback\n", __func__);
+        return 0;
+    }
+    return events_subscribe(event, options, callback, NULL, user_data);
+}
+
+int ACAP_EVENTS_Subscribe_View(cJSON* event, ACAP_EVENTS_View_Callback callback, void* user_data, cJSON* options) {
+    if (!callback) {
+        LOG_WARN("%s: Missing callback\n", __func__);
+        return 0;
+    }
+    return events_subscribe(event, options, NULL, callback, user_data);
+}
+
 int ACAP_EVENTS_Unsubscribe(int id) {
     LOG_TRACE("%s: Unsubscribing id=%d\n", __func__, id);
 
-    if (!ACAP_EVENTS_SUBSCRIPTIONS)
+    if (!ACAP_EVENTS_SUBSCRIBERS)
         return 0;
 
     if (id == 0) {
-        cJSON* event = ACAP_EVENTS_SUBSCRIPTIONS->child;
-        while (event) {
-            ax_event_handler_unsubscribe(ACAP_EVENTS_HANDLER, (guint)event->valueint, 0);
-            event = event->next;
-        }
-        cJSON_Delete(ACAP_EVENTS_SUBSCRIPTIONS);
-        ACAP_EVENTS_SUBSCRIPTIONS = cJSON_CreateArray();
-    } else {
-        int arraySize = cJSON_GetArraySize(ACAP_EVENTS_SUBSCRIPTIONS);
-        for (int i = 0; i < arraySize; i++) {
-            cJSON* item = cJSON_GetArrayItem(ACAP_EVENTS_SUBSCRIPTIONS, i);
-            if (item && item->valueint == id) {
-                ax_event_handler_unsubscribe(ACAP_EVENTS_HANDLER, (guint)id, 0);
-                cJSON_DeleteItemFromArray(ACAP_EVENTS_SUBSCRIPTIONS, i);
-                break;
-            }
-        }
+        GHashTableIter iter;
+        gpointer key;
+        g_hash_table_iter_init(&iter, ACAP_EVENTS_SUBSCRIBERS);
+        while (g_hash_table_iter_next(&iter, &key, NULL))
+            ax_event_handler_unsubscribe(ACAP_EVENTS_HANDLER, GPOINTER_TO_UINT(key), 0);
+        g_hash_table_remove_all(ACAP_EVENTS_SUBSCRIBERS);
+    } else if (g_hash_table_contains(ACAP_EVENTS_SUBSCRIBERS, GUINT_TO_POINTER((guint)id))) {
+        ax_event_handler_unsubscribe(ACAP_EVENTS_HANDLER, (guint)id, 0);
+        g_hash_table_remove(ACAP_EVENTS_SUBSCRIBERS, GUINT_TO_POINTER((guint)id));
+    }
+    return 1;
+}
+
+/*-----------------------------------------------------
+ * Declarations and event handles
+ *
+ * Each declared event keeps its axevent declaration id and a prepared
+ * key-value set with the event's data properties. Firing updates values
+ * in that set and sends it, instead of building a new set per call.
+ * The record doubles as the public ACAP_EVENT_Handle.
+ *
+ * Declarations complete asynchronously. The record is registered before
+ * the declaration is started, so the completion callback always finds
+ * it. Until the SDK reports it as done, events fired on it are held
+ * (newest DECLARATION_QUEUE_MAX) and sent in order from the completion
+ * callback. A declaration removed before it completes counts as settled
+ * for the "eventDeclarations" boot time.
+ *-----------------------------------------------------*/
+#define DECLARATION_QUEUE_MAX 32
+
+struct ACAP_EVENT_Handle_T {
+    char*               id;
+    guint               declaration;
+    int                 stateful;
+    pthread_mutex_t     lock;           /* Guards values */
+    AXEventKeyValueSet* values;         /* Data properties, updated in place */
+    int                 state;          /* Last state sent, read atomically */
+    pthread_mutex_t     state_lock;     /* Serializes state transitions */
+    int                 mirrored;       /* State last written to status (main loop only) */
+    size_t              fired;          /* Events sent */
+    size_t              failed;         /* Events that could not be created or sent */
+    int                 ready;          /* Declaration complete or removed (guarded by lock) */
+    AXEvent**           queued;         /* Fired before ready, sent on completion */
+    int                 queuedCount;
+};
+typedef struct ACAP_EVENT_Handle_T T_Declaration;
+
+static int events_state_dirty = 0;
+
+/* Outstanding declarations and when the current batch started */
+static int    declarations_pending = 0;
+static int    declarations_batch = 0;
+static gint64 declarations_start = 0;
+
+static void declaration_free(gpointer data) {
+    T_Declaration* decl = data;
+    if (!decl)
+        return;
+    ax_event_key_value_set_free(decl->values);
+    for (int i = 0; i < decl->queuedCount; i++)
+        ax_event_free(decl->queued[i]);
+    free(decl->queued);
+    pthread_mutex_destroy(&decl->lock);
+    pthread_mutex_destroy(&decl->state_lock);
+    free(decl->id);
+    free(decl);
+}
+
+/*
+ * Register a record, not ready, ahead of declaration_declare(). Handles stay
+ * valid until the event is removed, so an id is never registered twice.
+ * Takes ownership of values.
+ */
+static T_Declaration* declaration_register(const char* id, int stateful, AXEventKeyValueSet* values) {
+    if (g_hash_table_contains(ACAP_EVENTS_DECLARATIONS, id)) {
+        LOG_WARN("%s: Event %s is already declared\n", __func__, id);
+        ax_event_key_value_set_free(values);
+        return NULL;
+    }
+    T_Declaration* decl = calloc(1, sizeof(T_Declaration));
+    if (!decl || !(decl->id = strdup(id))) {
+        free(decl);
+        ax_event_key_value_set_free(values);
+        return NULL;
+    }
+    decl->stateful = stateful;
+    decl->values = values;
+    pthread_mutex_init(&decl->lock, NULL);
+    pthread_mutex_init(&decl->state_lock, NULL);
+    g_hash_table_insert(ACAP_EVENTS_DECLARATIONS, decl->id, decl);
+    return decl;
+}
+
+static T_Declaration* declaration_find(const char* id) {
+    if (!ACAP_EVENTS_DECLARATIONS || !id)
+        return NULL;
+    return g_hash_table_lookup(ACAP_EVENTS_DECLARATIONS, id);
+}
+
+/* Send and free an event; returns 1 on success */
+static int declaration_send(T_Declaration* decl, AXEvent* axEvent) {
+    GError* error = NULL;
+    int sent = ax_event_handler_send_event(ACAP_EVENTS_HANDLER, decl->declaration, axEvent, &error);
+    if (!sent) {
+        LOG_WARN("%s: Could not send event %s %s\n", __func__, decl->id, error ? error->message : "");
+        if (error)
+            g_error_free(error);
+    }
+    ax_event_free(axEvent);
+    __atomic_add_fetch(sent ? &decl->fired : &decl->failed, 1, __ATOMIC_RELAXED);
+    return sent;
+}
+
+/* Hold an event until the declaration completes; call with decl->lock held */
+static int declaration_queue(T_Declaration* decl, AXEvent* axEvent) {
+    if (!decl->queued && !(decl->queued = calloc(DECLARATION_QUEUE_MAX, sizeof(AXEvent*)))) {
+        ax_event_free(axEvent);
+        __atomic_add_fetch(&decl->failed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if (decl->queuedCount == DECLARATION_QUEUE_MAX) {
+        ax_event_free(decl->queued[0]);
+        memmove(decl->queued, decl->queued + 1, (DECLARATION_QUEUE_MAX - 1) * sizeof(AXEvent*));
+        decl->queuedCount--;
+        __atomic_add_fetch(&decl->failed, 1, __ATOMIC_RELAXED);
+    }
+    decl->queued[decl->queuedCount++] = axEvent;
+    return 1;
+}
+
+/* One outstanding declaration fewer; the last one records the batch time */
+static void declaration_settled(void) {
+    if (__atomic_sub_fetch(&declarations_pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        double ms = (g_get_monotonic_time() - declarations_start) / 1000.0;
+        ACAP_STATUS_SetNumber("boot", "eventDeclarations", round(ms * 10) / 10);
+        LOG("%d event declarations completed in %.1f ms\n", declarations_batch, ms);
+    }
+}
+
+static void declaration_complete(guint declaration, gpointer user_data) {
+    char* id = user_data;
+    T_Declaration* decl = declaration_find(id);
+    int settled = 0;
+    if (decl && decl->declaration == declaration) {
+        /* Flushed under the lock so later fires cannot overtake queued ones */
+        pthread_mutex_lock(&decl->lock);
+        settled = !decl->ready;
+        decl->ready = 1;
+        for (int i = 0; i < decl->queuedCount; i++)
+            declaration_send(decl, decl->queued[i]);
+        if (decl->queuedCount)
+            LOG_TRACE("%s: %s sent %d queued events\n", __func__, id, decl->queuedCount);
+        free(decl->queued);
+        decl->queued = NULL;
+        decl->queuedCount = 0;
+        pthread_mutex_unlock(&decl->lock);
+    }
+    free(id);
+    /* A record removed or replaced meanwhile was settled by ACAP_EVENTS_Remove_Event() */
+    if (settled)
+        declaration_settled();
+}
+
+/*
+ * Start the asynchronous declaration of a registered record; declaration_complete()
+ * marks it ready. On failure the record is removed again.
+ */
+static int declaration_declare(T_Declaration* decl, AXEventKeyValueSet* set, int stateless) {
+    char* context = strdup(decl->id);
+    if (!context) {
+        g_hash_table_remove(ACAP_EVENTS_DECLARATIONS, decl->id);
+        return 0;
+    }
+    if (__atomic_fetch_add(&declarations_pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        declarations_start = g_get_monotonic_time();
+        declarations_batch = 0;
+    }
+    if (!ax_event_handler_declare(ACAP_EVENTS_HANDLER, set, stateless, &decl->declaration, declaration_complete, context, NULL)) {
+        __atomic_sub_fetch(&declarations_pending, 1, __ATOMIC_ACQ_REL);
+        free(context);
+        g_hash_table_remove(ACAP_EVENTS_DECLARATIONS, decl->id);
+        return 0;
+    }
+    __atomic_add_fetch(&declarations_batch, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+/* Add a property with its type's zero value; returns 0 on unknown type */
+static int declaration_add_default(AXEventKeyValueSet* set, const char* name, const char* type, GError** error) {
+    int defaultInt = 0;
+    double defaultDouble = 0;
+    char defaultString[] = "";
+
+    if (strcmp(type, "string") == 0)
+        return ax_event_key_value_set_add_key_value(set, name, NULL, &defaultString, AX_VALUE_TYPE_STRING, error);
+    if (strcmp(type, "int") == 0)
+        return ax_event_key_value_set_add_key_value(set, name, NULL, &defaultInt, AX_VALUE_TYPE_INT, error);
+    if (strcmp(type, "double") == 0)
+        return ax_event_key_value_set_add_key_value(set, name, NULL, &defaultDouble, AX_VALUE_TYPE_DOUBLE, error);
+    if (strcmp(type, "bool") == 0)
+        return ax_event_key_value_set_add_key_value(set, name, NULL, &defaultInt, AX_VALUE_TYPE_BOOL, error);
+    return 0;
+}
+
+ACAP_EVENT_Handle ACAP_EVENTS_Get_Handle(const char* id) {
+    ACAP_EVENT_Handle handle = declaration_find(id);
+    if (!handle)
+        LOG_WARN("%s: Event %s not found\n", __func__, id ? id : "(null)");
+    return handle;
+}
+
+int ACAP_EVENTS_Set_Int(ACAP_EVENT_Handle handle, const char* name, int value) {
+    if (!handle || !name)
+        return 0;
+    pthread_mutex_lock(&handle->lock);
+    int ok = ax_event_key_value_set_add_key_value(handle->values, name, NULL, &value, AX_VALUE_TYPE_INT, NULL);
+    pthread_mutex_unlock(&handle->lock);
+    return ok;
+}
+
+int ACAP_EVENTS_Set_Bool(ACAP_EVENT_Handle handle, const char* name, int value) {
+    if (!handle || !name)
+        return 0;
+    value = value ? 1 : 0;
+    pthread_mutex_lock(&handle->lock);
+    int ok = ax_event_key_value_set_add_key_value(handle->values, name, NULL, &value, AX_VALUE_TYPE_BOOL, NULL);
+    pthread_mutex_unlock(&handle->lock);
+    return ok;
+}
+
+int ACAP_EVENTS_Set_Double(ACAP_EVENT_Handle handle, const char* name, double value) {
+    if (!handle || !name)
+        return 0;
+    pthread_mutex_lock(&handle->lock);
+    int ok = ax_event_key_value_set_add_key_value(handle->values, name, NULL, &value, AX_VALUE_TYPE_DOUBLE, NULL);
+    pthread_mutex_unlock(&handle->lock);
+    return ok;
+}
+
+int ACAP_EVENTS_Set_String(ACAP_EVENT_Handle handle, const char* name, const char* value) {
+    if (!handle || !name || !value)
+        return 0;
+    pthread_mutex_lock(&handle->lock);
+    int ok = ax_event_key_value_set_add_key_value(handle->values, name, NULL, value, AX_VALUE_TYPE_STRING, NULL);
+    pthread_mutex_unlock(&handle->lock);
+    return ok;
+}
+
+/*
+ * Create an event from the current values, or hold it until declared; call with
+ * decl->lock held. The event takes its own copy of the values. Returns 0 on failure;
+ * on success *send is the event to pass to declaration_send(), or NULL if held.
+ */
+static int declaration_snapshot(T_Declaration* decl, AXEvent** send) {
+    *send = NULL;
+    AXEvent* axEvent = ax_event_new2(decl->values, NULL);
+    if (!axEvent) {
+        LOG_WARN("%s: Could not create event %s\n", __func__, decl->id);
+        __atomic_add_fetch(&decl->failed, 1, __ATOMIC_RELAXED);
+        return 0;
     }
+    if (!decl->ready) {
+        LOG_TRACE("%s: %s queued until declared\n", __func__, decl->id);
+        return declaration_queue(decl, axEvent);
+    }
+    *send = axEvent;
+    return 1;
+}
+
+int ACAP_EVENTS_Fire_Handle(ACAP_EVENT_Handle handle) {
+    if (!handle || !ACAP_EVENTS_HANDLER)
+        return 0;
+
+    AXEvent* axEvent = NULL;
+    pthread_mutex_lock(&handle->lock);
+    int ok = declaration_snapshot(handle, &axEvent);
+    pthread_mutex_unlock(&handle->lock);
+    if (!axEvent)
+        return ok;
+
+    if (!declaration_send(handle, axEvent))
+        return 0;
+    LOG_TRACE("%s: %s fired\n", __func__, handle->id);
     return 1;
 }
 
 int ACAP_EVENTS_Add_Event(const char* id, const char* name, int state) {
     AXEventKeyValueSet* set = NULL;
     int dummy_value = 0;
-    guint declarationID;
 
     if (!ACAP_EVENTS_HANDLER || !id || !name || !ACAP_EVENTS_DECLARATIONS) {
         LOG_WARN("ACAP_EVENTS_Add_Event: Invalid input\n");
         return 0;
     }
+    if (declaration_find(id)) {
+        LOG_WARN("%s: Event %s is already declared\n", __func__, id);
+        return 0;
+    }
 
     set = ax_event_key_value_set_new();
     ax_event_key_value_set_add_key_value(set, "topic0", "tnsaxis", "CameraApplicationPlatform", AX_VALUE_TYPE_STRING, NULL);
@@ -1792,27 +4630,27 @@ int ACAP_EVENTS_Add_Event(const char* id, const char* name, int state) {
     ax_event_key_value_set_add_key_value(set, "topic2", "tnsaxis", id, AX_VALUE_TYPE_STRING, NULL);
     ax_event_key_value_set_add_nice_names(set, "topic2", "tnsaxis", id, name, NULL);
 
-    int ax = 0;
+    AXEventKeyValueSet* values = ax_event_key_value_set_new();
     if (state) {
         ax_event_key_value_set_add_key_value(set, "state", NULL, &dummy_value, AX_VALUE_TYPE_BOOL, NULL);
         ax_event_key_value_set_mark_as_data(set, "state", NULL, NULL);
-        ax = ax_event_handler_declare(ACAP_EVENTS_HANDLER, set, 0, &declarationID, NULL, NULL, NULL);
+        ax_event_key_value_set_add_key_value(values, "state", NULL, &dummy_value, AX_VALUE_TYPE_BOOL, NULL);
     } else {
         ax_event_key_value_set_add_key_value(set, "value", NULL, &dummy_value, AX_VALUE_TYPE_INT, NULL);
         ax_event_key_value_set_mark_as_data(set, "value", NULL, NULL);
-        ax = ax_event_handler_declare(ACAP_EVENTS_HANDLER, set, 1, &declarationID, NULL, NULL, NULL);
+        ax_event_key_value_set_add_key_value(values, "value", NULL, &dummy_value, AX_VALUE_TYPE_INT, NULL);
     }
 
-    if (!ax) {
+    T_Declaration* decl = declaration_register(id, state, values);
+    if (!decl || !declaration_declare(decl, set, state ? 0 : 1)) {
         LOG_WARN("Error declaring event\n");
         ax_event_key_value_set_free(set);
         return 0;
     }
     LOG_TRACE("%s: %s %s %s\n", __func__, id, name, state ? "Stateful" : "Stateless");
 
-    cJSON_AddNumberToObject(ACAP_EVENTS_DECLARATIONS, id, declarationID);
     ax_event_key_value_set_free(set);
-    return declarationID;
+    return decl->declaration;
 }
 
 int ACAP_EVENTS_Remove_Event(const char* id) {
@@ -1822,151 +4660,269 @@ int ACAP_EVENTS_Remove_Event(const char* id) {
         return 0;
     }
 
-    cJSON* event = cJSON_DetachItemFromObject(ACAP_EVENTS_DECLARATIONS, id);
-    if (!event) {
+    T_Declaration* decl = declaration_find(id);
+    if (!decl) {
         LOG_WARN("Error removing event %s. Event not found\n", id);
         return 0;
     }
 
-    ax_event_handler_undeclare(ACAP_EVENTS_HANDLER, event->valueint, NULL);
-    cJSON_Delete(event);
+    /* Its completion, if still due, no longer finds the record */
+    pthread_mutex_lock(&decl->lock);
+    int settled = !decl->ready;
+    decl->ready = 1;
+    pthread_mutex_unlock(&decl->lock);
+
+    ax_event_handler_undeclare(ACAP_EVENTS_HANDLER, decl->declaration, NULL);
+    g_hash_table_remove(ACAP_EVENTS_DECLARATIONS, id);
+    if (settled)
+        declaration_settled();
     return 1;
 }
 
 int ACAP_EVENTS_Fire(const char* id) {
-    GError* error = NULL;
     LOG_TRACE("%s: %s\n", __func__, id);
 
-    if (!ACAP_EVENTS_DECLARATIONS || !id) {
-        LOG_WARN("ACAP_EVENTS_Fire: Error send event\n");
+    T_Declaration* decl = declaration_find(id);
+    if (!decl) {
+        LOG_WARN("%s: Event %s not found\n", __func__, id ? id : "(null)");
         return 0;
     }
-
-    cJSON* event = cJSON_GetObjectItem(ACAP_EVENTS_DECLARATIONS, id);
-    if (!event) {
-        LOG_WARN("%s: Event %s not found\n", __func__, id);
+    if (!ACAP_EVENTS_Set_Int(decl, "value", 1)) {
+        LOG_WARN("%s: %s Unable to set value\n", __func__, id);
         return 0;
     }
+    return ACAP_EVENTS_Fire_Handle(decl);
+}
 
-    AXEventKeyValueSet* set = ax_event_key_value_set_new();
-    guint value = 1;
-    if (!ax_event_key_value_set_add_key_value(set, "value", NULL, &value, AX_VALUE_TYPE_INT, &error)) {
-        ax_event_key_value_set_free(set);
-        LOG_WARN("%s: %s error %s\n", __func__, id, error->message);
-        g_error_free(error);
-        return 0;
+/*-----------------------------------------------------
+ * Stateful events
+ *
+ * The current state lives in the declaration record. Unchanged states
+ * are rejected with a single atomic read; a transition is re-checked
+ * and sent under the record's state lock so concurrent fires go out in
+ * the order they are recorded. The "events" status group is updated
+ * from the main loop, batched, rather than on every transition.
+ *-----------------------------------------------------*/
+static gboolean events_state_mirror(gpointer data) {
+    __atomic_store_n(&events_state_dirty, 0, __ATOMIC_SEQ_CST);
+    if (!ACAP_EVENTS_DECLARATIONS)
+        return G_SOURCE_REMOVE;
+
+    GHashTableIter iter;
+    T_Declaration* decl;
+    g_hash_table_iter_init(&iter, ACAP_EVENTS_DECLARATIONS);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&decl)) {
+        int state = __atomic_load_n(&decl->state, __ATOMIC_ACQUIRE);
+        if (decl->stateful && state != decl->mirrored) {
+            ACAP_STATUS_SetBool("events", decl->id, state);
+            decl->mirrored = state;
+        }
     }
+    return G_SOURCE_REMOVE;
+}
 
-    AXEvent* axEvent = ax_event_new2(set, NULL);
-    ax_event_key_value_set_free(set);
+static void events_state_changed(void) {
+    if (!__atomic_exchange_n(&events_state_dirty, 1, __ATOMIC_SEQ_CST))
+        g_idle_add(events_state_mirror, NULL);
+}
 
-    if (!ax_event_handler_send_event(ACAP_EVENTS_HANDLER, event->valueint, axEvent, &error)) {
-        LOG_WARN("%s: Could not send event %s %s\n", __func__, id, error->message);
-        ax_event_free(axEvent);
-        g_error_free(error);
+/* Returns 1 if sent, 0 if the state was unchanged, -1 on failure */
+static int events_state_transition(T_Declaration* decl, int value) {
+    value = value ? 1 : 0;
+    if (__atomic_load_n(&decl->state, __ATOMIC_ACQUIRE) == value)
+        return 0;
+
+    pthread_mutex_lock(&decl->state_lock);
+    if (__atomic_load_n(&decl->state, __ATOMIC_ACQUIRE) == value) {
+        pthread_mutex_unlock(&decl->state_lock);
         return 0;
     }
-    ax_event_free(axEvent);
-    LOG_TRACE("%s: %s fired\n", __func__, id);
+    AXEvent* axEvent = NULL;
+    pthread_mutex_lock(&decl->lock);
+    int ok = ax_event_key_value_set_add_key_value(decl->values, "state", NULL, &value, AX_VALUE_TYPE_BOOL, NULL) &&
+             declaration_snapshot(decl, &axEvent);
+    pthread_mutex_unlock(&decl->lock);
+    if (ok && axEvent)
+        ok = declaration_send(decl, axEvent);
+    if (!ok) {
+        pthread_mutex_unlock(&decl->state_lock);
+        LOG_WARN("%s: Could not send event %s\n", __func__, decl->id);
+        return -1;
+    }
+    __atomic_store_n(&decl->state, value, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&decl->state_lock);
+    LOG_TRACE("%s: %s %d fired\n", __func__, decl->id, value);
     return 1;
 }
 
-int ACAP_EVENTS_Fire_State(const char* id, int value) {
-    if (value && ACAP_STATUS_Bool("events", id))
-        return 1;
-    if (!value && !ACAP_STATUS_Bool("events", id))
-        return 1;
+int ACAP_EVENTS_Fire_State_Handle(ACAP_EVENT_Handle handle, int value) {
+    if (!handle)
+        return 0;
+    int result = events_state_transition(handle, value);
+    if (result > 0)
+        events_state_changed();
+    return result >= 0;
+}
 
+int ACAP_EVENTS_Fire_State(const char* id, int value) {
     LOG_TRACE("%s: %s %d\n", __func__, id, value);
 
-    if (!ACAP_EVENTS_DECLARATIONS || !id) {
-        LOG_WARN("ACAP_EVENTS_Fire_State: Error send event\n");
+    T_Declaration* decl = declaration_find(id);
+    if (!decl) {
+        LOG_WARN("Error sending event %s. Event not found\n", id ? id : "(null)");
         return 0;
     }
+    return ACAP_EVENTS_Fire_State_Handle(decl, value);
+}
 
-    cJSON* event = cJSON_GetObjectItem(ACAP_EVENTS_DECLARATIONS, id);
-    if (!event) {
-        LOG_WARN("Error sending event %s. Event not found\n", id);
-        return 0;
-    }
+int ACAP_EVENTS_Get_State(const char* id) {
+    T_Declaration* decl = declaration_find(id);
+    return decl ? __atomic_load_n(&decl->state, __ATOMIC_ACQUIRE) : 0;
+}
 
-    AXEventKeyValueSet* set = ax_event_key_value_set_new();
-    if (!ax_event_key_value_set_add_key_value(set, "state", NULL, &value, AX_VALUE_TYPE_BOOL, NULL)) {
-        ax_event_key_value_set_free(set);
-        LOG_WARN("ACAP_EVENTS_Fire_State: Could not send event %s\n", id);
+int ACAP_EVENTS_Fire_Batch(const ACAP_EVENT_Update* updates, size_t count) {
+    if (!updates || !ACAP_EVENTS_HANDLER || !ACAP_EVENTS_DECLARATIONS) {
+        LOG_WARN("%s: Invalid input\n", __func__);
         return 0;
     }
 
-    AXEvent* axEvent = ax_event_new2(set, NULL);
-    ax_event_key_value_set_free(set);
-
-    if (!ax_event_handler_send_event(ACAP_EVENTS_HANDLER, event->valueint, axEvent, NULL)) {
-        LOG_WARN("ACAP_EVENTS_Fire_State: Could not send event %s\n", id);
-        ax_event_free(axEvent);
-        return 0;
+    int ok = 1;
+    int changed = 0;
+    for (size_t i = 0; i < count; i++) {
+        T_Declaration* decl = updates[i].handle ? updates[i].handle : declaration_find(updates[i].id);
+        if (!decl) {
+            LOG_WARN("%s: Event %s not found\n", __func__, updates[i].id ? updates[i].id : "(null)");
+            ok = 0;
+            continue;
+        }
+        if (decl->stateful) {
+            int result = events_state_transition(decl, updates[i].state);
+            if (result < 0)
+                ok = 0;
+            changed |= result > 0;
+        } else if (updates[i].state) {
+            if (!ACAP_EVENTS_Set_Int(decl, "value", 1) || !ACAP_EVENTS_Fire_Handle(decl))
+                ok = 0;
+        }
     }
-    ax_event_free(axEvent);
-    ACAP_STATUS_SetBool("events", id, value);
-    LOG_TRACE("ACAP_EVENTS_Fire_State: %s %d fired\n", id, value);
-    return 1;
+    if (changed)
+        events_state_changed();
+    return ok;
 }
 
 int ACAP_EVENTS_Fire_JSON(const char* Id, cJSON* data) {
-    AXEventKeyValueSet* set = NULL;
-    int boolValue;
-    GError* error = NULL;
-
     if (!data) {
         LOG_WARN("%s: Invalid data", __func__);
         return 0;
     }
 
-    cJSON* event = cJSON_GetObjectItem(ACAP_EVENTS_DECLARATIONS, Id);
-    if (!event) {
-        LOG_WARN("%s: Error sending event %s. Event not found\n", __func__, Id);
+    T_Declaration* decl = declaration_find(Id);
+    if (!decl) {
+        LOG_WARN("%s: Error sending event %s. Event not found\n", __func__, Id ? Id : "(null)");
         return 0;
     }
 
-    set = ax_event_key_value_set_new();
+    if (!ACAP_EVENTS_HANDLER)
+        return 0;
+
+    /* Values and event under one lock, so concurrent fires cannot mix their properties */
     int success = 0;
+    AXEvent* axEvent = NULL;
+    pthread_mutex_lock(&decl->lock);
     cJSON* property = data->child;
     while (property) {
-        if (property->type == cJSON_True) {
-            boolValue = 1;
-            success = ax_event_key_value_set_add_key_value(set, property->string, NULL, &boolValue, AX_VALUE_TYPE_BOOL, NULL);
-        }
-        if (property->type == cJSON_False) {
-            boolValue = 0;
-            success = ax_event_key_value_set_add_key_value(set, property->string, NULL, &boolValue, AX_VALUE_TYPE_BOOL, NULL);
-        }
-        if (property->type == cJSON_String) {
-            success = ax_event_key_value_set_add_key_value(set, property->string, NULL, property->valuestring, AX_VALUE_TYPE_STRING, NULL);
-        }
-        if (property->type == cJSON_Number) {
-            success = ax_event_key_value_set_add_key_value(set, property->string, NULL, &property->valuedouble, AX_VALUE_TYPE_DOUBLE, NULL);
-        }
+        int flag = cJSON_IsTrue(property);
+        if (!property->string)
+            success = 0;
+        else if (cJSON_IsBool(property))
+            success = ax_event_key_value_set_add_key_value(decl->values, property->string, NULL, &flag, AX_VALUE_TYPE_BOOL, NULL);
+        else if (cJSON_IsString(property) && property->valuestring)
+            success = ax_event_key_value_set_add_key_value(decl->values, property->string, NULL, property->valuestring, AX_VALUE_TYPE_STRING, NULL);
+        else if (cJSON_IsNumber(property))
+            success = ax_event_key_value_set_add_key_value(decl->values, property->string, NULL, &property->valuedouble, AX_VALUE_TYPE_DOUBLE, NULL);
         if (!success)
             LOG_WARN("%s: Unable to add property\n", __func__);
         property = property->next;
     }
+    int sent = declaration_snapshot(decl, &axEvent);
+    pthread_mutex_unlock(&decl->lock);
+    if (axEvent)
+        sent = declaration_send(decl, axEvent);
 
-    AXEvent* axEvent = ax_event_new2(set, NULL);
-    success = ax_event_handler_send_event(ACAP_EVENTS_HANDLER, event->valueint, axEvent, &error);
-    ax_event_key_value_set_free(set);
-    ax_event_free(axEvent);
-    if (!success) {
-        LOG_WARN("%s: Could not send event %s id = %d %s\n", __func__, Id, event->valueint, error->message);
-        g_error_free(error);
+    if (!sent) {
+        LOG_WARN("%s: Could not send event %s id = %u\n", __func__, Id, decl->declaration);
         return 0;
     }
     return 1;
 }
 
+static gint64 events_stats_time = 0;
+
+static cJSON* events_stats_subscription(T_Subscription* sub, double seconds) {
+    T_EventStats* stats = &sub->stats;
+    size_t received = __atomic_load_n(&stats->received, __ATOMIC_RELAXED);
+    size_t delivered = __atomic_load_n(&stats->delivered, __ATOMIC_RELAXED);
+    guint64 parse_us = __atomic_load_n(&stats->parse_us, __ATOMIC_RELAXED);
+    guint64 callback_us = __atomic_load_n(&stats->callback_us, __ATOMIC_RELAXED);
+
+    cJSON* item = cJSON_CreateObject();
+    if (sub->name)
+        cJSON_AddStringToObject(item, "name", sub->name);
+    cJSON_AddNumberToObject(item, "received", received);
+    cJSON_AddNumberToObject(item, "ratePerSec", seconds > 0 ? (received - stats->sampled) / seconds : 0);
+    cJSON_AddNumberToObject(item, "filtered", __atomic_load_n(&stats->filtered, __ATOMIC_RELAXED));
+    cJSON_AddNumberToObject(item, "delivered", delivered);
+    cJSON_AddNumberToObject(item, "dropped", __atomic_load_n(&stats->dropped, __ATOMIC_RELAXED));
+    cJSON_AddNumberToObject(item, "coalesced", __atomic_load_n(&stats->coalesced, __ATOMIC_RELAXED));
+    cJSON_AddNumberToObject(item, "parseUs", delivered ? (double)parse_us / delivered : 0);
+    cJSON_AddNumberToObject(item, "callbackUs", delivered ? (double)callback_us / delivered : 0);
+    cJSON_AddNumberToObject(item, "callbackMaxUs", __atomic_load_n(&stats->callback_max_us, __ATOMIC_RELAXED));
+    cJSON* histogram = cJSON_AddObjectToObject(item, "callbackHistogram");
+    for (int i = 0; i < EVENT_LATENCY_BUCKETS; i++)
+        cJSON_AddNumberToObject(histogram, EVENT_LATENCY_NAMES[i], __atomic_load_n(&stats->latency[i], __ATOMIC_RELAXED));
+    stats->sampled = received;
+    return item;
+}
+
+/* Main loop timer: copy the counters into the "eventStats" status group */
+static gboolean events_stats_sample(gpointer data) {
+    gint64 now = g_get_monotonic_time();
+    double seconds = events_stats_time ? (now - events_stats_time) / 1000000.0 : 0;
+    events_stats_time = now;
+
+    cJSON* subscriptions = cJSON_CreateObject();
+    if (ACAP_EVENTS_SUBSCRIBERS) {
+        GHashTableIter iter;
+        gpointer key;
+        T_Subscription* sub;
+        char id[16];
+        g_hash_table_iter_init(&iter, ACAP_EVENTS_SUBSCRIBERS);
+        while (g_hash_table_iter_next(&iter, &key, (gpointer*)&sub)) {
+            snprintf(id, sizeof(id), "%u", GPOINTER_TO_UINT(key));
+            cJSON_AddItemToObject(subscriptions, id, events_stats_subscription(sub, seconds));
+        }
+    }
+
+    cJSON* declarations = cJSON_CreateObject();
+    if (ACAP_EVENTS_DECLARATIONS) {
+        GHashTableIter iter;
+        T_Declaration* decl;
+        g_hash_table_iter_init(&iter, ACAP_EVENTS_DECLARATIONS);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&decl)) {
+            cJSON* item = cJSON_AddObjectToObject(declarations, decl->id);
+            cJSON_AddNumberToObject(item, "fired", __atomic_load_n(&decl->fired, __ATOMIC_RELAXED));
+            cJSON_AddNumberToObject(item, "failed", __atomic_load_n(&decl->failed, __ATOMIC_RELAXED));
+        }
+    }
+
+    status_set_item("eventStats", "subscriptions", subscriptions);
+    status_set_item("eventStats", "declarations", declarations);
+    return G_SOURCE_CONTINUE;
+}
+
 int ACAP_EVENTS_Add_Event_JSON(cJSON* event) {
     AXEventKeyValueSet* set = NULL;
     GError* error = NULL;
-    guint declarationID;
-    int success = 0;
     set = ax_event_key_value_set_new();
 
     char* eventID   = cJSON_GetObjectItem(event, "id")   ? cJSON_GetObjectItem(event, "id")->valuestring   : NULL;
@@ -1977,6 +4933,11 @@ int ACAP_EVENTS_Add_Event_JSON(cJSON* event) {
         ax_event_key_value_set_free(set);
         return 0;
     }
+    if (declaration_find(eventID)) {
+        LOG_WARN("%s: Event %s is already declared\n", __func__, eventID);
+        ax_event_key_value_set_free(set);
+        return 0;
+    }
 
     ax_event_key_value_set_add_key_value(set, "topic0", "tnsaxis", "CameraApplicationPlatform", AX_VALUE_TYPE_STRING, NULL);
     ax_event_key_value_set_add_key_value(set, "topic1", "tnsaxis", ACAP_EVENTS_PACKAGE, AX_VALUE_TYPE_STRING, NULL);
@@ -1985,23 +4946,18 @@ int ACAP_EVENTS_Add_Event_JSON(cJSON* event) {
     if (eventName)
         ax_event_key_value_set_add_nice_names(set, "topic2", "tnsaxis", eventID, eventName, NULL);
 
-    if (cJSON_GetObjectItem(event, "show") && cJSON_GetObjectItem(event, "show")->type == cJSON_False)
+    if (cJSON_IsFalse(cJSON_GetObjectItem(event, "show")))
         ax_event_key_value_set_mark_as_user_defined(set, eventID, "tnsaxis", "isApplicationData", NULL);
 
     int defaultInt = 0;
-    double defaultDouble = 0;
-    char defaultString[] = "";
+    AXEventKeyValueSet* values = ax_event_key_value_set_new();
 
     cJSON* source = cJSON_GetObjectItem(event, "source") ? cJSON_GetObjectItem(event, "source")->child : NULL;
     while (source) {
         cJSON* property = source->child;
-        if (property) {
-            if (strcmp(property->valuestring, "string") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultString, AX_VALUE_TYPE_STRING, NULL);
-            if (strcmp(property->valuestring, "int") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultInt, AX_VALUE_TYPE_INT, NULL);
-            if (strcmp(property->valuestring, "bool") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultInt, AX_VALUE_TYPE_BOOL, NULL);
+        if (property && property->valuestring && strcmp(property->valuestring, "double") != 0) {
+            declaration_add_default(set, property->string, property->valuestring, NULL);
+            declaration_add_default(values, property->string, property->valuestring, NULL);
             ax_event_key_value_set_mark_as_source(set, property->string, NULL, NULL);
             LOG_TRACE("%s: %s Source %s %s\n", __func__, eventID, property->string, property->valuestring);
         }
@@ -2012,47 +4968,42 @@ int ACAP_EVENTS_Add_Event_JSON(cJSON* event) {
     int propertyCounter = 0;
     while (dataItem) {
         cJSON* property = dataItem->child;
-        if (property) {
+        if (property && property->valuestring) {
             propertyCounter++;
-            if (strcmp(property->valuestring, "string") == 0) {
-                if (!ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultString, AX_VALUE_TYPE_STRING, &error)) {
-                    LOG_WARN("%s: Unable to add string %s %s\n", __func__, property->string, error->message);
-                    g_error_free(error);
-                    error = NULL;
-                }
+            if (!declaration_add_default(set, property->string, property->valuestring, &error) && error) {
+                LOG_WARN("%s: Unable to add %s %s\n", __func__, property->string, error->message);
+                g_error_free(error);
+                error = NULL;
             }
-            if (strcmp(property->valuestring, "int") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultInt, AX_VALUE_TYPE_INT, NULL);
-            if (strcmp(property->valuestring, "double") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultDouble, AX_VALUE_TYPE_DOUBLE, NULL);
-            if (strcmp(property->valuestring, "bool") == 0)
-                ax_event_key_value_set_add_key_value(set, property->string, NULL, &defaultInt, AX_VALUE_TYPE_BOOL, NULL);
+            declaration_add_default(values, property->string, property->valuestring, NULL);
             ax_event_key_value_set_mark_as_data(set, property->string, NULL, NULL);
             LOG_TRACE("%s: %s Data %s %s\n", __func__, eventID, property->string, property->valuestring);
         }
         dataItem = dataItem->next;
     }
 
-    if (propertyCounter == 0)
+    if (propertyCounter == 0) {
         ax_event_key_value_set_add_key_value(set, "value", NULL, &defaultInt, AX_VALUE_TYPE_INT, NULL);
+        ax_event_key_value_set_add_key_value(values, "value", NULL, &defaultInt, AX_VALUE_TYPE_INT, NULL);
+    }
 
-    if (cJSON_GetObjectItem(event, "state") && cJSON_GetObjectItem(event, "state")->type == cJSON_True) {
+    int stateful = cJSON_IsTrue(cJSON_GetObjectItem(event, "state"));
+    if (stateful) {
         ax_event_key_value_set_add_key_value(set, "state", NULL, &defaultInt, AX_VALUE_TYPE_BOOL, NULL);
         ax_event_key_value_set_mark_as_data(set, "state", NULL, NULL);
+        ax_event_key_value_set_add_key_value(values, "state", NULL, &defaultInt, AX_VALUE_TYPE_BOOL, NULL);
         LOG_TRACE("%s: %s is stateful\n", __func__, eventID);
-        success = ax_event_handler_declare(ACAP_EVENTS_HANDLER, set, 0, &declarationID, NULL, NULL, NULL);
-    } else {
-        success = ax_event_handler_declare(ACAP_EVENTS_HANDLER, set, 1, &declarationID, NULL, NULL, NULL);
     }
-    LOG_TRACE("%s: %s ID = %d\n", __func__, eventID, declarationID);
-    if (!success) {
+
+    T_Declaration* decl = declaration_register(eventID, stateful, values);
+    if (!decl || !declaration_declare(decl, set, stateful ? 0 : 1)) {
         ax_event_key_value_set_free(set);
         LOG_WARN("Unable to register event %s\n", eventID);
         return 0;
     }
-    cJSON_AddNumberToObject(ACAP_EVENTS_DECLARATIONS, eventID, declarationID);
+    LOG_TRACE("%s: %s ID = %d\n", __func__, eventID, decl->declaration);
     ax_event_key_value_set_free(set);
-    return declarationID;
+    return decl->declaration;
 }
 
 /*=====================================================
@@ -2080,11 +5031,19 @@ static size_t append_to_buffer_callback(char* ptr, size_t size, size_t nmemb, vo
     return processed_bytes;
 }
 
-char* ACAP_VAPIX_Get(const char* endpoint) {
-    if (!VAPIX_CURL || !endpoint) {
+/*
+ * Perform a VAPIX request on the given curl handle. A NULL body issues a GET,
+ * otherwise the body is POSTed. The caller serializes access to the handle.
+ */
+static char* vapix_perform(CURL* curl, const char* endpoint, const char* body) {
+    if (!curl || !endpoint) {
         LOG_WARN("%s: Invalid input\n", __func__);
         return NULL;
     }
+    if (body && !VAPIX_Credentials) {
+        LOG_WARN("%s: No VAPIX credentials for POST %s\n", __func__, endpoint);
+        return NULL;
+    }
 
     char* response = NULL;
     const char* host = VAPIX_Credentials ? "127.0.0.12" : "127.0.0.1";
@@ -2096,20 +5055,21 @@ char* ACAP_VAPIX_Get(const char* endpoint) {
     }
     snprintf(url, url_size, "http://%s/axis-cgi/%s", host, endpoint);
 
-    pthread_mutex_lock(&vapix_mutex);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     if (VAPIX_Credentials) {
-        curl_easy_setopt(VAPIX_CURL, CURLOPT_USERPWD, VAPIX_Credentials);
-        curl_easy_setopt(VAPIX_CURL, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+        curl_easy_setopt(curl, CURLOPT_USERPWD, VAPIX_Credentials);
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
     } else {
-        curl_easy_setopt(VAPIX_CURL, CURLOPT_HTTPAUTH, 0L);
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, 0L);
     }
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_HTTPGET, 1L);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_WRITEFUNCTION, append_to_buffer_callback);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_WRITEDATA, &response);
+    if (body)
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    else
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append_to_buffer_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(VAPIX_CURL);
-    pthread_mutex_unlock(&vapix_mutex);
+    CURLcode res = curl_easy_perform(curl);
     free(url);
 
     if (res != CURLE_OK) {
@@ -2119,7 +5079,7 @@ char* ACAP_VAPIX_Get(const char* endpoint) {
     }
 
     long response_code;
-    curl_easy_getinfo(VAPIX_CURL, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
     if (response_code >= 300) {
         LOG_WARN("%s: Code %ld %s\n", __func__, response_code, response ? response : "No response");
         free(response);
@@ -2130,50 +5090,29 @@ char* ACAP_VAPIX_Get(const char* endpoint) {
     return response;
 }
 
-char* ACAP_VAPIX_Post(const char* endpoint, const char* request) {
-    if (!VAPIX_Credentials || !VAPIX_CURL || !endpoint || !request) {
+char* ACAP_VAPIX_Get(const char* endpoint) {
+    if (!VAPIX_CURL || !endpoint) {
         LOG_WARN("%s: Invalid input\n", __func__);
         return NULL;
     }
 
-    LOG_TRACE("%s: %s %s\n", __func__, endpoint, request);
-
-    char* response = NULL;
-    size_t url_size = strlen("http://127.0.0.12/axis-cgi/") + strlen(endpoint) + 1;
-    char* url = malloc(url_size);
-    if (!url) {
-        LOG_WARN("%s: Memory allocation failed", __func__);
-        return NULL;
-    }
-    snprintf(url, url_size, "http://127.0.0.12/axis-cgi/%s", endpoint);
-
     pthread_mutex_lock(&vapix_mutex);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_URL, url);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_USERPWD, VAPIX_Credentials);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_POSTFIELDS, request);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_WRITEFUNCTION, append_to_buffer_callback);
-    curl_easy_setopt(VAPIX_CURL, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(VAPIX_CURL);
+    char* response = vapix_perform(VAPIX_CURL, endpoint, NULL);
     pthread_mutex_unlock(&vapix_mutex);
-    free(url);
+    return response;
+}
 
-    if (res != CURLE_OK) {
-        LOG_WARN("%s: %d: %s", __func__, res, curl_easy_strerror(res));
-        free(response);
+char* ACAP_VAPIX_Post(const char* endpoint, const char* request) {
+    if (!VAPIX_Credentials || !VAPIX_CURL || !endpoint || !request) {
+        LOG_WARN("%s: Invalid input\n", __func__);
         return NULL;
     }
 
-    long response_code;
-    curl_easy_getinfo(VAPIX_CURL, CURLINFO_RESPONSE_CODE, &response_code);
-    if (response_code >= 300) {
-        LOG_WARN("%s: Code %ld %s\n", __func__, response_code, response ? response : "No response");
-        free(response);
-        return NULL;
-    }
+    LOG_TRACE("%s: %s %s\n", __func__, endpoint, request);
 
-    LOG_TRACE("%s: %s\n", __func__, response ? response : "No response");
+    pthread_mutex_lock(&vapix_mutex);
+    char* response = vapix_perform(VAPIX_CURL, endpoint, request);
+    pthread_mutex_unlock(&vapix_mutex);
     return response;
 }
 
@@ -2249,15 +5188,29 @@ void ACAP_Cleanup(void) {
         ax_event_handler_free(ACAP_EVENTS_HANDLER);
         ACAP_EVENTS_HANDLER = NULL;
     }
-    if (ACAP_EVENTS_SUBSCRIPTIONS) {
-        cJSON_Delete(ACAP_EVENTS_SUBSCRIPTIONS);
-        ACAP_EVENTS_SUBSCRIPTIONS = NULL;
+    dispatch_stop(0);
+    ACAP_EVENTS_Record(NULL);
+    ACAP_EVENTS_SetHistory(0);
+    if (events_stats_timer) {
+        g_source_remove(events_stats_timer);
+        events_stats_timer = 0;
+    }
+    pthread_mutex_lock(&event_state_lock);
+    if (event_state_cache) {
+        g_hash_table_destroy(event_state_cache);
+        event_state_cache = NULL;
+    }
+    pthread_mutex_unlock(&event_state_lock);
+    if (ACAP_EVENTS_SUBSCRIBERS) {
+        g_hash_table_destroy(ACAP_EVENTS_SUBSCRIBERS);
+        ACAP_EVENTS_SUBSCRIBERS = NULL;
     }
     if (ACAP_EVENTS_DECLARATIONS) {
-        cJSON_Delete(ACAP_EVENTS_DECLARATIONS);
+        g_hash_table_destroy(ACAP_EVENTS_DECLARATIONS);
         ACAP_EVENTS_DECLARATIONS = NULL;
     }
 
+    device_lazy_cleanup();
     status_container = NULL;
     ACAP_DEVICE_Container = NULL;
 
@@ -2277,6 +5230,7 @@ void ACAP_Cleanup(void) {
 
     http_node_count = 0;
     ACAP_UpdateCallback = NULL;
+    cJSON_ReleaseThreadBuffers();
 }
 
 /*=====================================================
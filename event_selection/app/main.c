@@ -21,36 +21,13 @@ static guint timerId = 0;
 
 /*
  * Extract a boolean state value from an incoming event.
- * Checks common property names used across Axis event types.
- * Returns 1 for active/true, 0 for inactive/false.
+ * ACAP_EVENTS_Event_State() remembers which property carries the state
+ * for each event topic. Returns 1 for active/true, 0 for inactive/false.
  */
 static int
 Extract_Event_State(cJSON* event) {
-	const char* stateProperties[] = {
-		"active", "state", "triggered", "LogicalState",
-		"ready", "Open", "lost", "Detected", "recording",
-		"accessed", "connected", "day", "sensor_level",
-		"disruption", "alert", "fan_failure", "Failed",
-		"limit_exceeded", "abr_error", "tampering",
-		"signal_status_ok", "Playing", NULL
-	};
-
-	for (int i = 0; stateProperties[i]; i++) {
-		cJSON* item = cJSON_GetObjectItem(event, stateProperties[i]);
-		if (item) {
-			if (cJSON_IsBool(item))
-				return cJSON_IsTrue(item) ? 1 : 0;
-			if (cJSON_IsNumber(item))
-				return item->valueint ? 1 : 0;
-			if (cJSON_IsString(item)) {
-				if (strcmp(item->valuestring, "1") == 0 ||
-				    strcmp(item->valuestring, "true") == 0)
-					return 1;
-				return 0;
-			}
-		}
-	}
-	return 1;  // Default to active if no recognized state property
+	int state = ACAP_EVENTS_Event_State(event);
+	return state < 0 ? 1 : state;  // Default to active if no recognized state property
 }
 
 /*
@@ -59,12 +36,7 @@ Extract_Event_State(cJSON* event) {
  */
 void
 My_Event_Callback(cJSON *event, void* userdata) {
-	char* json = cJSON_PrintUnformatted(event);
-	if (json) {
-		LOG("Event received: %s\n", json);
-		free(json);
-	}
-
+	// Received events are listed by the /events endpoint; no per-event logging
 	int state = Extract_Event_State(event);
 	ACAP_EVENTS_Fire_State("state", state);
 	ACAP_EVENTS_Fire("trigger");
@@ -297,7 +297,7 @@ MQTT_Connect() {
 
     cJSON *connect_item = cJSON_GetObjectItem(MQTTSettings, "connect");
     if (connect_item) {
-        connect_item->type = cJSON_True;
+        cJSON_ReplaceItemInObject(MQTTSettings, "connect", cJSON_CreateTrue());
 		ACAP_FILE_Write("localdata/mqtt.json", MQTTSettings);
 	}
    
@@ -363,8 +363,42 @@ MQTT_Publish(const char *topic, const char *payload, int qos, int retained) {
     return (rc == MQTTASYNC_SUCCESS);
 }
 
-int
-MQTT_Publish_JSON(const char *topic, cJSON *payload, int qos, int retained) {
+/* MQTT topic filter match: '+' matches one level, a trailing '#' the rest */
+static int
+MQTT_Topic_Matches(const char *filter, const char *topic) {
+    while (*filter) {
+        if (*filter == '#')
+            return 1;
+        if (*filter == '+') {
+            while (*topic && *topic != '/')
+                topic++;
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) {
+            /* "a/#" also matches "a" */
+            return *topic == '\0' && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+        }
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
+
+/* Topics listed in the "cborTopics" setting are published CBOR-encoded */
+static int
+MQTT_Topic_Uses_CBOR(const char *topic) {
+    cJSON* filters = cJSON_GetObjectItem(MQTTSettings, "cborTopics");
+    cJSON* filter;
+    cJSON_ArrayForEach(filter, filters) {
+        if (cJSON_IsString(filter) && MQTT_Topic_Matches(filter->valuestring, topic))
+            return 1;
+    }
+    return 0;
+}
+
+static int
+MQTT_Publish_Object(const char *topic, cJSON *payload, int qos, int retained, int cbor) {
 
     if (!mqtt_client || !mqtt.isConnected(mqtt_client)) {
         return 0;
@@ -400,20 +434,36 @@ MQTT_Publish_JSON(const char *topic, cJSON *payload, int qos, int retained) {
         cJSON_AddStringToObject(publish, "serial", serial);
     }
     
-    char* json = cJSON_PrintUnformatted(publish);
     int result = 0;
-    
-    if (json) {
-        result = MQTT_Publish(topic, json, qos, retained);
-        free(json);
+    if (cbor) {
+        size_t length = 0;
+        const unsigned char* data = cJSON_PrintThreadBufferCBOR(publish, &length);
+        if (data)
+            result = MQTT_Publish_Binary(topic, (int)length, (void*)data, qos, retained);
+        else
+            LOG_WARN("%s: Failed to encode CBOR\n", __func__);
     } else {
-        LOG_WARN("%s: Failed to serialize JSON\n", __func__);
+        const char* json = cJSON_PrintThreadBuffer(publish, 0, NULL);
+        if (json)
+            result = MQTT_Publish(topic, json, qos, retained);
+        else
+            LOG_WARN("%s: Failed to serialize JSON\n", __func__);
     }
     
     cJSON_Delete(publish);
     return result;
 }
 
+int
+MQTT_Publish_JSON(const char *topic, cJSON *payload, int qos, int retained) {
+    return MQTT_Publish_Object(topic, payload, qos, retained, topic && MQTT_Topic_Uses_CBOR(topic));
+}
+
+int
+MQTT_Publish_CBOR(const char *topic, cJSON *payload, int qos, int retained) {
+    return MQTT_Publish_Object(topic, payload, qos, retained, 1);
+}
+
 int
 MQTT_Publish_Binary(const char *topic, int payloadlen, void *payload, int qos, int retained) {
     
@@ -29,7 +29,8 @@ int    MQTT_Init( MQTT_Callback_Connection stateCallback, MQTT_Callback_Message
 void   MQTT_Cleanup();
 cJSON* MQTT_Settings();
 int    MQTT_Publish( const char *topic, const char *payload, int qos, int retained );
-int    MQTT_Publish_JSON( const char *topic, cJSON *payload, int qos, int retained );
+int    MQTT_Publish_JSON( const char *topic, cJSON *payload, int qos, int retained );  /* CBOR for topics in "cborTopics" */
+int    MQTT_Publish_CBOR( const char *topic, cJSON *payload, int qos, int retained );
 int    MQTT_Publish_Binary( const char *topic, int payloadlen, void *payload, int qos, int retained );
 int    MQTT_Subscribe( const char *topic );
 int    MQTT_Unsubscribe( const char *topic );
@@ -44,6 +44,12 @@
 #include <limits.h>
 #include <ctype.h>
 #include <float.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)) || defined(_MSC_VER)
+#include <stdint.h>
+#endif
 
 #ifdef ENABLE_LOCALES
 #include <locale.h>
@@ -237,6 +243,493 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
+/* Scoped arenas. While an arena is active on the current thread, nodes, keys and
+ * string values are carved from it and released all at once by cJSON_ArenaEnd.
+ * Print buffers and cJSON_malloc always come from the global hooks. */
+#ifndef CJSON_ARENA_BLOCK_SIZE
+#define CJSON_ARENA_BLOCK_SIZE 4096
+#endif
+#define CJSON_ARENA_ALIGNMENT 16
+#define arena_align(size) (((size) + (CJSON_ARENA_ALIGNMENT - 1)) & ~(size_t)(CJSON_ARENA_ALIGNMENT - 1))
+
+#if defined(_MSC_VER)
+#define CJSON_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define CJSON_THREAD_LOCAL __thread
+#else
+#define CJSON_THREAD_LOCAL
+#endif
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block;
+
+#define arena_block_header arena_align(sizeof(arena_block))
+#define arena_block_data(block) ((unsigned char*)(block) + arena_block_header)
+
+typedef struct intern_table intern_table;
+
+struct cJSON_Arena
+{
+    arena_block *blocks;
+    size_t block_size;
+    struct cJSON_Arena *parent;
+    int parent_suspended;
+    intern_table *keys; /* interned keys, allocated inside the arena */
+    arena_block **sorted; /* blocks by address, for ownership lookups on free */
+    size_t sorted_count;
+    size_t sorted_capacity;
+};
+
+static CJSON_THREAD_LOCAL cJSON_Arena *current_arena = NULL;
+static CJSON_THREAD_LOCAL int arena_suspended = 0;
+
+static arena_block *arena_block_new(size_t size)
+{
+    arena_block *block = (arena_block*)global_hooks.allocate(arena_block_header + size);
+    if (block != NULL)
+    {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+
+    return block;
+}
+
+/* keep the block in the address-ordered index used by arena_owns */
+static cJSON_bool arena_index_add(cJSON_Arena * const arena, arena_block * const block)
+{
+    size_t low = 0;
+    size_t high = arena->sorted_count;
+
+    if (arena->sorted_count == arena->sorted_capacity)
+    {
+        size_t capacity = (arena->sorted_capacity > 0) ? arena->sorted_capacity * 2 : 8;
+        arena_block **sorted = (arena_block**)global_hooks.allocate(capacity * sizeof(arena_block*));
+        if (sorted == NULL)
+        {
+            return false;
+        }
+        if (arena->sorted != NULL)
+        {
+            memcpy(sorted, arena->sorted, arena->sorted_count * sizeof(arena_block*));
+            global_hooks.deallocate(arena->sorted);
+        }
+        arena->sorted = sorted;
+        arena->sorted_capacity = capacity;
+    }
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if ((const unsigned char*)arena->sorted[middle] < (const unsigned char*)block)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    memmove(arena->sorted + low + 1, arena->sorted + low, (arena->sorted_count - low) * sizeof(arena_block*));
+    arena->sorted[low] = block;
+    arena->sorted_count++;
+
+    return true;
+}
+
+static arena_block *arena_block_add(cJSON_Arena * const arena, size_t size)
+{
+    arena_block *block = arena_block_new(size);
+    if ((block != NULL) && !arena_index_add(arena, block))
+    {
+        global_hooks.deallocate(block);
+        return NULL;
+    }
+
+    return block;
+}
+
+static void * CJSON_CDECL node_allocate(size_t size)
+{
+    cJSON_Arena *arena = current_arena;
+    arena_block *block = NULL;
+    size_t needed = 0;
+
+    if ((arena == NULL) || arena_suspended)
+    {
+        return global_hooks.allocate(size);
+    }
+
+    needed = arena_align(size);
+    block = arena->blocks;
+    if ((block == NULL) || ((block->size - block->used) < needed))
+    {
+        if ((block != NULL) && (needed > (arena->block_size / 4)))
+        {
+            /* large allocation: own block behind the current one so its free space is kept */
+            arena_block *large = arena_block_add(arena, needed);
+            if (large == NULL)
+            {
+                return NULL;
+            }
+            large->used = needed;
+            large->next = block->next;
+            block->next = large;
+            return arena_block_data(large);
+        }
+
+        block = arena_block_add(arena, (needed > arena->block_size) ? needed : arena->block_size);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    block->used += needed;
+    return arena_block_data(block) + block->used - needed;
+}
+
+static cJSON_bool arena_owns(const void *pointer)
+{
+    const unsigned char *p = (const unsigned char*)pointer;
+    cJSON_Arena *arena = NULL;
+
+    for (arena = current_arena; arena != NULL; arena = arena->parent)
+    {
+        /* last block starting at or below the pointer */
+        size_t low = 0;
+        size_t high = arena->sorted_count;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if ((const unsigned char*)arena->sorted[middle] <= p)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        if (low > 0)
+        {
+            arena_block *block = arena->sorted[low - 1];
+            if ((p >= arena_block_data(block)) && (p < (arena_block_data(block) + block->size)))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void CJSON_CDECL node_deallocate(void *pointer)
+{
+    /* arena memory is only released as a whole */
+    if ((current_arena != NULL) && arena_owns(pointer))
+    {
+        return;
+    }
+    global_hooks.deallocate(pointer);
+}
+
+static internal_hooks node_hooks = { node_allocate, node_deallocate, NULL };
+
+CJSON_PUBLIC(cJSON_Arena *) cJSON_ArenaBegin(size_t block_size)
+{
+    cJSON_Arena *arena = (cJSON_Arena*)global_hooks.allocate(sizeof(cJSON_Arena));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->blocks = NULL;
+    arena->block_size = (block_size > 0) ? block_size : CJSON_ARENA_BLOCK_SIZE;
+    arena->parent = current_arena;
+    arena->parent_suspended = arena_suspended;
+    arena->keys = NULL;
+    arena->sorted = NULL;
+    arena->sorted_count = 0;
+    arena->sorted_capacity = 0;
+    current_arena = arena;
+    arena_suspended = 0;
+
+    return arena;
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaEnd(cJSON_Arena *arena)
+{
+    arena_block *block = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    /* ending an outer arena also ends the ones nested inside it */
+    while ((current_arena != NULL) && (current_arena != arena))
+    {
+        cJSON_ArenaEnd(current_arena);
+    }
+    if (current_arena == arena)
+    {
+        current_arena = arena->parent;
+        arena_suspended = arena->parent_suspended;
+    }
+
+    while (arena->blocks != NULL)
+    {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        global_hooks.deallocate(block);
+    }
+    if (arena->sorted != NULL)
+    {
+        global_hooks.deallocate(arena->sorted);
+    }
+    global_hooks.deallocate(arena);
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaSuspend(void)
+{
+    arena_suspended++;
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaResume(void)
+{
+    if (arena_suspended > 0)
+    {
+        arena_suspended--;
+    }
+}
+
+static void* cast_away_const(const void* string);
+
+/* Key interning. Keys are stored once per table and shared by every node that uses them,
+ * flagged cJSON_StringIsConst so deleting a node leaves them alone. Arena keys live in a
+ * table allocated inside the arena and go away with it. Heap keys live in one global table
+ * for the rest of the process; it is bounded and guarded by a mutex (a spinning waiter
+ * would burn its whole time slice behind a preempted holder on single-core cameras), and
+ * is only available where POSIX threads are. */
+#ifndef CJSON_INTERN_MAX_KEYS
+#define CJSON_INTERN_MAX_KEYS 4096
+#endif
+#ifndef CJSON_INTERN_MAX_LENGTH
+#define CJSON_INTERN_MAX_LENGTH 64
+#endif
+
+typedef struct
+{
+    const char *key;
+    size_t length;
+    size_t hash;
+} intern_entry;
+
+struct intern_table
+{
+    intern_entry *slots;
+    size_t capacity; /* power of two */
+    size_t count;
+};
+
+static int key_interning = 0;
+static intern_table global_keys = { NULL, 0, 0 };
+#if defined(__unix__) || defined(__APPLE__)
+static pthread_mutex_t global_keys_lock = PTHREAD_MUTEX_INITIALIZER;
+#define intern_global_available 1
+#define intern_global_lock() pthread_mutex_lock(&global_keys_lock)
+#define intern_global_unlock() pthread_mutex_unlock(&global_keys_lock)
+#else
+#define intern_global_available 0
+#define intern_global_lock()
+#define intern_global_unlock()
+#endif
+
+CJSON_PUBLIC(void) cJSON_SetKeyInterning(int tables)
+{
+    key_interning = tables;
+}
+
+static size_t intern_hash(const unsigned char *key, size_t length)
+{
+    size_t hash = (size_t)2166136261U;
+    size_t i = 0;
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (size_t)key[i];
+        hash *= (size_t)16777619U;
+    }
+
+    return hash;
+}
+
+/* The table keys created on this thread go to, or NULL when interning does not apply */
+static intern_table *intern_target(void)
+{
+    if ((current_arena != NULL) && !arena_suspended)
+    {
+        if (!(key_interning & cJSON_InternArena))
+        {
+            return NULL;
+        }
+        if (current_arena->keys == NULL)
+        {
+            current_arena->keys = (intern_table*)node_allocate(sizeof(intern_table));
+            if (current_arena->keys != NULL)
+            {
+                memset(current_arena->keys, 0, sizeof(intern_table));
+            }
+        }
+        return current_arena->keys;
+    }
+
+    if ((key_interning & cJSON_InternGlobal) && intern_global_available)
+    {
+        return &global_keys;
+    }
+
+    return NULL;
+}
+
+static cJSON_bool intern_grow(intern_table * const table, cJSON_bool in_arena)
+{
+    size_t capacity = (table->capacity > 0) ? (table->capacity * 2) : 64;
+    size_t mask = capacity - 1;
+    intern_entry *slots = NULL;
+    size_t i = 0;
+
+    slots = (intern_entry*)(in_arena ? node_allocate(capacity * sizeof(intern_entry)) : global_hooks.allocate(capacity * sizeof(intern_entry)));
+    if (slots == NULL)
+    {
+        return false;
+    }
+    memset(slots, 0, capacity * sizeof(intern_entry));
+
+    for (i = 0; i < table->capacity; i++)
+    {
+        if (table->slots[i].key != NULL)
+        {
+            size_t position = table->slots[i].hash & mask;
+            while (slots[position].key != NULL)
+            {
+                position = (position + 1) & mask;
+            }
+            slots[position] = table->slots[i];
+        }
+    }
+
+    /* arena tables leave the old array to the arena */
+    if (!in_arena && (table->slots != NULL))
+    {
+        global_hooks.deallocate(table->slots);
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+
+    return true;
+}
+
+static const char *intern_in(intern_table * const table, const unsigned char *key, size_t length)
+{
+    cJSON_bool in_arena = (table != &global_keys);
+    cJSON_bool full = false;
+    size_t hash = intern_hash(key, length);
+    size_t position = 0;
+    char *copy = NULL;
+
+    if ((table->count + 1) * 2 > table->capacity)
+    {
+        /* when the table cannot grow it still answers for the keys it holds */
+        full = (!in_arena && (table->count >= CJSON_INTERN_MAX_KEYS)) || !intern_grow(table, in_arena);
+        if (table->capacity == 0)
+        {
+            return NULL;
+        }
+    }
+
+    position = hash & (table->capacity - 1);
+    while (table->slots[position].key != NULL)
+    {
+        if ((table->slots[position].hash == hash) && (table->slots[position].length == length) && (memcmp(table->slots[position].key, key, length) == 0))
+        {
+            return table->slots[position].key;
+        }
+        position = (position + 1) & (table->capacity - 1);
+    }
+
+    if (full)
+    {
+        return NULL;
+    }
+
+    copy = (char*)(in_arena ? node_allocate(length + 1) : global_hooks.allocate(length + 1));
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    table->slots[position].key = copy;
+    table->slots[position].length = length;
+    table->slots[position].hash = hash;
+    table->count++;
+
+    return copy;
+}
+
+/* Shared copy of key[0..length) from the table that applies on this thread, or NULL */
+static const char *intern_key(const unsigned char *key, size_t length)
+{
+    intern_table *table = NULL;
+    const char *interned = NULL;
+
+    if ((key_interning == 0) || (length > CJSON_INTERN_MAX_LENGTH))
+    {
+        return NULL;
+    }
+
+    table = intern_target();
+    if (table == NULL)
+    {
+        return NULL;
+    }
+    if (table != &global_keys)
+    {
+        return intern_in(table, key, length);
+    }
+
+    intern_global_lock();
+    interned = intern_in(table, key, length);
+    intern_global_unlock();
+
+    return interned;
+}
+
+CJSON_PUBLIC(const char *) cJSON_InternKey(const char *key)
+{
+    const char *interned = NULL;
+
+    if (key == NULL)
+    {
+        return NULL;
+    }
+    interned = intern_key((const unsigned char*)key, strlen(key));
+
+    return (interned != NULL) ? interned : key;
+}
+
+typedef struct cJSON_Index object_index;
+static void index_release(object_index *index);
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
@@ -262,15 +755,20 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         }
         if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
         {
-            global_hooks.deallocate(item->valuestring);
+            node_hooks.deallocate(item->valuestring);
             item->valuestring = NULL;
         }
+        if (!(item->type & cJSON_IsReference) && (item->index != NULL))
+        {
+            index_release(item->index);
+            item->index = NULL;
+        }
         if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
         {
-            global_hooks.deallocate(item->string);
+            node_hooks.deallocate(item->string);
             item->string = NULL;
         }
-        global_hooks.deallocate(item);
+        node_hooks.deallocate(item);
         item = next;
     }
 }
@@ -418,7 +916,7 @@ CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
         strcpy(object->valuestring, valuestring);
         return object->valuestring;
     }
-    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
+    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &node_hooks);
     if (copy == NULL)
     {
         return NULL;
@@ -549,41 +1047,414 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
-/* Render the number nicely from the given item into a string. */
-static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)) || defined(_MSC_VER)
+#define CJSON_SHORTEST_NUMBERS
+#endif
+
+#ifdef CJSON_SHORTEST_NUMBERS
+/* Round-trip digits for doubles (Grisu2, after Florian Loitsch,
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010).
+ * Produces the digits and decimal exponent without any libc formatting call. The
+ * digits always read back as the same double and are nearly always the shortest. */
+typedef struct
 {
-    unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
-    int length = 0;
-    size_t i = 0;
-    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
-    double test = 0.0;
+    uint64_t f;
+    int e;
+} diy_fp;
+
+#define DIY_FP_HIDDEN_BIT UINT64_C(0x0010000000000000)
+#define DIY_FP_SIGNIFICAND_MASK UINT64_C(0x000FFFFFFFFFFFFF)
+
+static const uint64_t cached_powers_f[] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+    UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+    UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+    UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+    UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+    UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+    UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)
+};
+
+static const short cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+static const uint64_t pow10_table[] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000), UINT64_C(100000),
+    UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000), UINT64_C(1000000000),
+    UINT64_C(10000000000), UINT64_C(100000000000), UINT64_C(1000000000000),
+    UINT64_C(10000000000000), UINT64_C(100000000000000), UINT64_C(1000000000000000),
+    UINT64_C(10000000000000000), UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000)
+};
+
+static diy_fp diy_fp_multiply(diy_fp x, diy_fp y)
+{
+    const uint64_t mask32 = UINT64_C(0xFFFFFFFF);
+    uint64_t a = x.f >> 32;
+    uint64_t b = x.f & mask32;
+    uint64_t c = y.f >> 32;
+    uint64_t d = y.f & mask32;
+    uint64_t ac = a * c;
+    uint64_t bc = b * c;
+    uint64_t ad = a * d;
+    uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & mask32) + (bc & mask32);
+    diy_fp result;
+
+    tmp += UINT64_C(1) << 31; /* round */
+    result.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    result.e = x.e + y.e + 64;
+
+    return result;
+}
 
-    if (output_buffer == NULL)
+static diy_fp diy_fp_normalize(diy_fp value)
+{
+    while (!(value.f & (UINT64_C(1) << 63)))
     {
-        return false;
+        value.f <<= 1;
+        value.e--;
     }
 
-    /* This checks for NaN and Infinity */
-    if (isnan(d) || isinf(d))
-    {
+    return value;
+}
+
+static void grisu_round(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while ((rest < wp_w) && ((delta - rest) >= ten_kappa) &&
+           (((rest + ten_kappa) < wp_w) || ((wp_w - rest) > (rest + ten_kappa - wp_w))))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void grisu_digits(diy_fp w, diy_fp mp, uint64_t delta, char *buffer, int *length, int *K)
+{
+    const int one_e = -mp.e;
+    const uint64_t one_f = UINT64_C(1) << one_e;
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> one_e);
+    uint64_t p2 = mp.f & (one_f - 1);
+    int kappa = 1;
+
+    while ((kappa < 10) && (p1 >= pow10_table[kappa]))
+    {
+        kappa++;
+    }
+
+    *length = 0;
+    while (kappa > 0)
+    {
+        uint32_t digit = (uint32_t)(p1 / pow10_table[kappa - 1]);
+        uint64_t rest = 0;
+
+        p1 = (uint32_t)(p1 % pow10_table[kappa - 1]);
+        if ((digit != 0) || (*length != 0))
+        {
+            buffer[(*length)++] = (char)('0' + digit);
+        }
+        kappa--;
+        rest = ((uint64_t)p1 << one_e) + p2;
+        if (rest <= delta)
+        {
+            *K += kappa;
+            grisu_round(buffer, *length, delta, rest, pow10_table[kappa] << one_e, wp_w);
+            return;
+        }
+    }
+
+    for (;;)
+    {
+        char digit = 0;
+
+        p2 *= 10;
+        delta *= 10;
+        digit = (char)(p2 >> one_e);
+        if ((digit != 0) || (*length != 0))
+        {
+            buffer[(*length)++] = (char)('0' + digit);
+        }
+        p2 &= one_f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *K += kappa;
+            grisu_round(buffer, *length, delta, p2, one_f, (-kappa < 20) ? (wp_w * pow10_table[-kappa]) : 0);
+            return;
+        }
+    }
+}
+
+/* digits of a finite, positive d; returns the digit count, *K is the exponent of the last digit */
+static int grisu2(double d, char *buffer, int *K)
+{
+    uint64_t bits = 0;
+    diy_fp v;
+    diy_fp plus;
+    diy_fp minus;
+    diy_fp cached;
+    diy_fp w;
+    int biased_e = 0;
+    int k = 0;
+    int length = 0;
+    double dk = 0.0;
+    unsigned int index = 0;
+
+    memcpy(&bits, &d, sizeof(bits));
+    biased_e = (int)((bits >> 52) & 0x7FF);
+    v.f = bits & DIY_FP_SIGNIFICAND_MASK;
+    if (biased_e != 0)
+    {
+        v.f += DIY_FP_HIDDEN_BIT;
+        v.e = biased_e - 1075;
+    }
+    else
+    {
+        v.e = -1074;
+    }
+
+    /* boundaries m+ and m- of the rounding interval, sharing m+'s exponent */
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    while (!(plus.f & (DIY_FP_HIDDEN_BIT << 1)))
+    {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 10;
+    plus.e -= 10;
+    if (v.f == DIY_FP_HIDDEN_BIT)
+    {
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    }
+    else
+    {
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    /* cached power of ten bringing m+ into the [-60, -32] exponent window */
+    dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    k = (int)dk;
+    if ((dk - k) > 0.0)
+    {
+        k++;
+    }
+    index = (unsigned int)((k >> 3) + 1);
+    *K = -(-348 + (int)index * 8);
+    cached.f = cached_powers_f[index];
+    cached.e = cached_powers_e[index];
+
+    w = diy_fp_multiply(diy_fp_normalize(v), cached);
+    plus = diy_fp_multiply(plus, cached);
+    minus = diy_fp_multiply(minus, cached);
+    minus.f++;
+    plus.f--;
+    grisu_digits(w, plus, plus.f - minus.f, buffer, &length, K);
+
+    /* drop trailing zeros */
+    while ((length > 1) && (buffer[length - 1] == '0'))
+    {
+        length--;
+        (*K)++;
+    }
+
+    return length;
+}
+
+/* write digits the way printf("%.<precision>g") lays them out */
+static int format_digits(unsigned char *output, cJSON_bool negative, const char *digits, int length, int K, int precision)
+{
+    int exponent = length + K - 1; /* decimal exponent of the first digit */
+    int written = 0;
+    int i = 0;
+
+    if (negative)
+    {
+        output[written++] = '-';
+    }
+
+    if ((exponent < -4) || (exponent >= precision))
+    {
+        int magnitude = (exponent < 0) ? -exponent : exponent;
+        output[written++] = (unsigned char)digits[0];
+        if (length > 1)
+        {
+            output[written++] = '.';
+            for (i = 1; i < length; i++)
+            {
+                output[written++] = (unsigned char)digits[i];
+            }
+        }
+        output[written++] = 'e';
+        output[written++] = (exponent < 0) ? '-' : '+';
+        if (magnitude >= 100)
+        {
+            output[written++] = (unsigned char)('0' + magnitude / 100);
+            magnitude %= 100;
+        }
+        output[written++] = (unsigned char)('0' + magnitude / 10);
+        output[written++] = (unsigned char)('0' + magnitude % 10);
+    }
+    else if (exponent < 0)
+    {
+        output[written++] = '0';
+        output[written++] = '.';
+        for (i = -1; i > exponent; i--)
+        {
+            output[written++] = '0';
+        }
+        for (i = 0; i < length; i++)
+        {
+            output[written++] = (unsigned char)digits[i];
+        }
+    }
+    else
+    {
+        for (i = 0; i < length; i++)
+        {
+            if (i == exponent + 1)
+            {
+                output[written++] = '.';
+            }
+            output[written++] = (unsigned char)digits[i];
+        }
+        for (; i <= exponent; i++)
+        {
+            output[written++] = '0';
+        }
+    }
+
+    return written;
+}
+#endif /* CJSON_SHORTEST_NUMBERS */
+
+/* integers print without going through sprintf */
+static int format_integer(unsigned char *output, int value)
+{
+    unsigned char reversed[12];
+    unsigned int magnitude = (value < 0) ? (0U - (unsigned int)value) : (unsigned int)value;
+    int count = 0;
+    int written = 0;
+
+    do
+    {
+        reversed[count++] = (unsigned char)('0' + (magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        output[written++] = '-';
+    }
+    while (count > 0)
+    {
+        output[written++] = reversed[--count];
+    }
+
+    return written;
+}
+
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    double d = item->valuedouble;
+    int length = 0;
+    size_t i = 0;
+    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
+    unsigned char decimal_point = '.';
+    double test = 0.0;
+#ifdef CJSON_SHORTEST_NUMBERS
+    char digits[18];
+    int digit_count = 0;
+    int K = 0;
+#endif
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* This checks for NaN and Infinity */
+    if (isnan(d) || isinf(d))
+    {
         length = sprintf((char*)number_buffer, "null");
     }
     else if(d == (double)item->valueint)
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        length = format_integer(number_buffer, item->valueint);
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
-
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+#ifdef CJSON_SHORTEST_NUMBERS
+        /* Digits that read back exactly as d; up to 15 of them print exactly as "%1.15g" would */
+        digit_count = grisu2(fabs(d), digits, &K);
+        if (digit_count <= 15)
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char*)number_buffer, "%1.17g", d);
+            length = format_digits(number_buffer, d < 0, digits, digit_count, K, 15);
+        }
+        else
+#endif
+        {
+            decimal_point = get_decimal_point();
+
+            /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
+            length = sprintf((char*)number_buffer, "%1.15g", d);
+
+            /* Check whether the original double can be recovered. As before, this accepts
+             * a result within compare_double's tolerance, so it is not always exact. */
+            if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+            {
+#ifdef CJSON_SHORTEST_NUMBERS
+                /* If not, 16 exact digits are shorter than "%1.17g" and need no sprintf,
+                 * except for 17-digit integers where the layout pads them back to 17 */
+                if ((digit_count == 16) && (K != 1))
+                {
+                    decimal_point = '.';
+                    length = format_digits(number_buffer, d < 0, digits, digit_count, K, 17);
+                }
+                else
+#endif
+                {
+                    /* If not, print with 17 decimal places of precision */
+                    length = sprintf((char*)number_buffer, "%1.17g", d);
+                }
+            }
         }
     }
 
@@ -619,6 +1490,111 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     return true;
 }
 
+/* Vectorised scanning for the parser: 16 bytes per step with SSE2 (x86 hosts) or
+ * NEON (ARM cameras), byte by byte otherwise. Define CJSON_NO_SIMD to force the
+ * scalar code. All loads stay inside [pointer, end). */
+#if !defined(CJSON_NO_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CJSON_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CJSON_SIMD_NEON
+#endif
+#endif
+
+#if defined(CJSON_SIMD_NEON)
+/* NEON has no movemask; narrow each 0x00/0xFF byte to a nibble of a 64-bit mask */
+static uint64_t neon_mask(uint8x16_t matches)
+{
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+#endif
+
+/* first byte in [pointer, end) that is '"' or '\\', or end */
+static const unsigned char *scan_string_special(const unsigned char *pointer, const unsigned char *end)
+{
+#if defined(CJSON_SIMD_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while ((end - pointer) >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)pointer);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return pointer + __builtin_ctz((unsigned int)mask);
+        }
+        pointer += 16;
+    }
+#elif defined(CJSON_SIMD_NEON)
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    while ((end - pointer) >= 16)
+    {
+        uint8x16_t chunk = vld1q_u8(pointer);
+        uint64_t mask = neon_mask(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return pointer + (__builtin_ctzll(mask) >> 2);
+        }
+        pointer += 16;
+    }
+#endif
+    while ((pointer < end) && (*pointer != '\"') && (*pointer != '\\'))
+    {
+        pointer++;
+    }
+
+    return pointer;
+}
+
+/* first byte in [pointer, end) above 32 (the parser treats everything else as whitespace), or end */
+static const unsigned char *scan_whitespace(const unsigned char *pointer, const unsigned char *end)
+{
+#if defined(CJSON_SIMD_SSE2)
+    const __m128i space = _mm_set1_epi8(32);
+    /* most values follow their separator directly; don't pay for a vector load then */
+    if ((pointer < end) && (*pointer > 32))
+    {
+        return pointer;
+    }
+    while ((end - pointer) >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)pointer);
+        /* max(byte, 32) == 32 exactly when the unsigned byte is <= 32 */
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space)) ^ 0xFFFF;
+        if (mask != 0)
+        {
+            return pointer + __builtin_ctz((unsigned int)mask);
+        }
+        pointer += 16;
+    }
+#elif defined(CJSON_SIMD_NEON)
+    const uint8x16_t space = vdupq_n_u8(32);
+    if ((pointer < end) && (*pointer > 32))
+    {
+        return pointer;
+    }
+    while ((end - pointer) >= 16)
+    {
+        uint64_t mask = neon_mask(vcgtq_u8(vld1q_u8(pointer), space));
+        if (mask != 0)
+        {
+            return pointer + (__builtin_ctzll(mask) >> 2);
+        }
+        pointer += 16;
+    }
+#endif
+    while ((pointer < end) && (*pointer <= 32))
+    {
+        pointer++;
+    }
+
+    return pointer;
+}
+
 /* parse 4 digit hexadecimal number */
 static unsigned parse_hex4(const unsigned char * const input)
 {
@@ -795,22 +1771,24 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
         size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        const unsigned char *content_end = input_buffer->content + input_buffer->length;
+        for (;;)
         {
+            input_end = scan_string_special(input_end, content_end);
+            if ((input_end >= content_end) || (*input_end == '\"'))
+            {
+                break;
+            }
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if ((input_end + 1) >= content_end)
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
-        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
+        if ((input_end >= content_end) || (*input_end != '\"'))
         {
             goto fail; /* string ended unexpectedly */
         }
@@ -830,7 +1808,12 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         if (*input_pointer != '\\')
         {
-            *output_pointer++ = *input_pointer++;
+            /* copy the whole run up to the next escape at once */
+            const unsigned char *run_end = (const unsigned char*)memchr(input_pointer, '\\', (size_t)(input_end - input_pointer));
+            size_t run_length = (size_t)(((run_end != NULL) ? run_end : input_end) - input_pointer);
+            memcpy(output_pointer, input_pointer, run_length);
+            output_pointer += run_length;
+            input_pointer += run_length;
         }
         /* escape sequence */
         else
@@ -1056,10 +2039,7 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
-    {
-       buffer->offset++;
-    }
+    buffer->offset = (size_t)(scan_whitespace(buffer_at_offset(buffer), buffer->content + buffer->length) - buffer->content);
 
     if (buffer->offset == buffer->length)
     {
@@ -1118,9 +2098,9 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.content = (const unsigned char*)value;
     buffer.length = buffer_length;
     buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    buffer.hooks = node_hooks;
 
-    item = cJSON_New_Item(&global_hooks);
+    item = cJSON_New_Item(&node_hooks);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1193,71 +2173,104 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
-static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+/* Renderers leave output_buffer->offset at the end of what they wrote */
+typedef cJSON_bool (*print_renderer)(const cJSON * const item, printbuffer * const output_buffer);
+
+static cJSON_bool print_text(const cJSON * const item, printbuffer * const output_buffer)
+{
+    if (!print_value(item, output_buffer))
+    {
+        return false;
+    }
+    update_offset(output_buffer);
+
+    return true;
+}
+
+/* Render into a caller-owned growable buffer. *storage and *capacity are updated when the
+ * buffer grows (or is released by a failed grow), so the buffer can be reused by the next call. */
+
+static unsigned char *print_into(const cJSON * const item, print_renderer render, cJSON_bool format, unsigned char **storage, size_t *capacity, size_t *length)
 {
     static const size_t default_buffer_size = 256;
     printbuffer buffer[1];
-    unsigned char *printed = NULL;
-
-    memset(buffer, 0, sizeof(buffer));
+    cJSON_bool success = false;
 
-    /* create buffer */
-    buffer->buffer = (unsigned char*) hooks->allocate(default_buffer_size);
-    buffer->length = default_buffer_size;
-    buffer->format = format;
-    buffer->hooks = *hooks;
-    if (buffer->buffer == NULL)
+    if (*storage == NULL)
     {
-        goto fail;
+        *storage = (unsigned char*)global_hooks.allocate(default_buffer_size);
+        *capacity = (*storage != NULL) ? default_buffer_size : 0;
+        if (*storage == NULL)
+        {
+            return NULL;
+        }
     }
 
-    /* print the value */
-    if (!print_value(item, buffer))
+    memset(buffer, 0, sizeof(buffer));
+    buffer->buffer = *storage;
+    buffer->length = *capacity;
+    buffer->format = format;
+    buffer->hooks = global_hooks;
+
+    success = render(item, buffer);
+
+    /* ensure() may have moved or released the buffer */
+    *storage = buffer->buffer;
+    *capacity = buffer->length;
+    if (!success || (buffer->buffer == NULL))
     {
-        goto fail;
+        return NULL;
     }
-    update_offset(buffer);
 
-    /* check if reallocate is available */
-    if (hooks->reallocate != NULL)
+    buffer->buffer[buffer->offset] = '\0';
+    if (length != NULL)
     {
-        printed = (unsigned char*) hooks->reallocate(buffer->buffer, buffer->offset + 1);
-        if (printed == NULL) {
-            goto fail;
-        }
-        buffer->buffer = NULL;
+        *length = buffer->offset;
     }
-    else /* otherwise copy the JSON over to a new buffer */
-    {
-        printed = (unsigned char*) hooks->allocate(buffer->offset + 1);
-        if (printed == NULL)
-        {
-            goto fail;
-        }
-        memcpy(printed, buffer->buffer, cjson_min(buffer->length, buffer->offset + 1));
-        printed[buffer->offset] = '\0'; /* just to be sure */
 
-        /* free the buffer */
-        hooks->deallocate(buffer->buffer);
-        buffer->buffer = NULL;
-    }
+    return buffer->buffer;
+}
 
-    return printed;
+/* Buffers larger than this are released after use instead of being kept for the next print */
+#ifndef CJSON_PRINT_BUFFER_RETAIN
+#define CJSON_PRINT_BUFFER_RETAIN (1024 * 1024)
+#endif
 
-fail:
-    if (buffer->buffer != NULL)
+static void print_buffer_trim(unsigned char **storage, size_t *capacity)
+{
+    if ((*storage != NULL) && (*capacity > CJSON_PRINT_BUFFER_RETAIN))
     {
-        hooks->deallocate(buffer->buffer);
-        buffer->buffer = NULL;
+        global_hooks.deallocate(*storage);
+        *storage = NULL;
+        *capacity = 0;
     }
+}
+
+/* print() renders into its own per-thread scratch buffer and copies out the exact size,
+ * kept apart from the cJSON_PrintThreadBuffer result so neither clobbers the other */
+static CJSON_THREAD_LOCAL unsigned char *print_scratch = NULL;
+static CJSON_THREAD_LOCAL size_t print_scratch_size = 0;
+static CJSON_THREAD_LOCAL unsigned char *print_thread_buffer = NULL;
+static CJSON_THREAD_LOCAL size_t print_thread_buffer_size = 0;
+
+static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+{
+    unsigned char *rendered = NULL;
+    unsigned char *printed = NULL;
+    size_t length = 0;
 
-    if (printed != NULL)
+    rendered = print_into(item, print_text, format, &print_scratch, &print_scratch_size, &length);
+    if (rendered != NULL)
     {
-        hooks->deallocate(printed);
-        printed = NULL;
+        printed = (unsigned char*)hooks->allocate(length + 1);
+        if (printed != NULL)
+        {
+            memcpy(printed, rendered, length + 1);
+        }
     }
+    print_buffer_trim(&print_scratch, &print_scratch_size);
 
-    return NULL;
+    return printed;
 }
 
 /* Render a cJSON item/entity/structure to text. */
@@ -1302,84 +2315,187 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
     return (char*)p.buffer;
 }
 
-CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+CJSON_PUBLIC(char *) cJSON_PrintToBuffer(const cJSON *item, cJSON_PrintBuffer *buffer, cJSON_bool format, size_t *length)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    unsigned char *storage = NULL;
+    unsigned char *rendered = NULL;
 
-    if ((length < 0) || (buffer == NULL))
+    if (buffer == NULL)
     {
-        return false;
+        return NULL;
     }
 
-    p.buffer = (unsigned char*)buffer;
-    p.length = (size_t)length;
-    p.offset = 0;
-    p.noalloc = true;
-    p.format = format;
-    p.hooks = global_hooks;
+    storage = (unsigned char*)buffer->buffer;
+    rendered = print_into(item, print_text, format, &storage, &buffer->size, length);
+    buffer->buffer = (char*)storage;
 
-    return print_value(item, &p);
+    return (char*)rendered;
 }
 
-/* Parser core - when encountering text, process appropriately. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+CJSON_PUBLIC(void) cJSON_PrintBufferRelease(cJSON_PrintBuffer *buffer)
 {
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    if ((buffer == NULL) || (buffer->buffer == NULL))
     {
-        return false; /* no input */
+        return;
     }
+    global_hooks.deallocate(buffer->buffer);
+    buffer->buffer = NULL;
+    buffer->size = 0;
+}
 
-    /* parse the different types of values */
-    /* null */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
-    {
-        item->type = cJSON_NULL;
-        input_buffer->offset += 4;
-        return true;
+CJSON_PUBLIC(const char *) cJSON_PrintThreadBuffer(const cJSON *item, cJSON_bool format, size_t *length)
+{
+    unsigned char *rendered = NULL;
+
+    /* drop an oversized buffer kept from the previous call before reusing it */
+    print_buffer_trim(&print_thread_buffer, &print_thread_buffer_size);
+    rendered = print_into(item, print_text, format, &print_thread_buffer, &print_thread_buffer_size, length);
+
+    return (const char*)rendered;
+}
+
+CJSON_PUBLIC(void) cJSON_ReleaseThreadBuffers(void)
+{
+    if (print_scratch != NULL)
+    {
+        global_hooks.deallocate(print_scratch);
+        print_scratch = NULL;
+        print_scratch_size = 0;
     }
-    /* false */
-    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    if (print_thread_buffer != NULL)
     {
-        item->type = cJSON_False;
-        input_buffer->offset += 5;
-        return true;
+        global_hooks.deallocate(print_thread_buffer);
+        print_thread_buffer = NULL;
+        print_thread_buffer_size = 0;
     }
-    /* true */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+}
+
+/* CBOR (RFC 8949) encoding of cJSON trees. Integral numbers up to 2^53 become CBOR integers,
+ * numbers a float holds exactly become single precision, everything else double precision;
+ * cJSON_Raw travels as tag 262 (embedded JSON) on a byte string. Decoding maps the result
+ * back to the same cJSON types. */
+#define CBOR_TAG_EMBEDDED_JSON 262
+#define CBOR_INTEGER_LIMIT 9007199254740992.0 /* 2^53 */
+
+static cJSON_bool cbor_little_endian(void)
+{
+    unsigned int one = 1;
+    return *(unsigned char*)&one == 1;
+}
+
+/* copy n bytes of a host-order value into big-endian order, or back */
+static void cbor_swap(unsigned char *destination, const unsigned char *source, size_t n)
+{
+    size_t i = 0;
+    if (!cbor_little_endian())
     {
-        item->type = cJSON_True;
-        item->valueint = 1;
-        input_buffer->offset += 4;
+        memcpy(destination, source, n);
+        return;
+    }
+    for (i = 0; i < n; i++)
+    {
+        destination[i] = source[n - 1 - i];
+    }
+}
+
+static cJSON_bool cbor_put_head(printbuffer * const output_buffer, unsigned char major, double argument)
+{
+    unsigned char *output = ensure(output_buffer, 9);
+    unsigned char bytes = 0;
+    int i = 0;
+
+    if (output == NULL)
+    {
+        return false;
+    }
+
+    if (argument < 24)
+    {
+        output[0] = (unsigned char)((major << 5) | (unsigned char)argument);
+        output_buffer->offset += 1;
         return true;
     }
-    /* string */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    bytes = (argument < 256.0) ? 1 : (argument < 65536.0) ? 2 : (argument < 4294967296.0) ? 4 : 8;
+    output[0] = (unsigned char)((major << 5) | ((bytes == 1) ? 24 : (bytes == 2) ? 25 : (bytes == 4) ? 26 : 27));
+    if (bytes < 8)
     {
-        return parse_string(item, input_buffer);
+        unsigned long value = (unsigned long)argument;
+        for (i = bytes; i > 0; i--)
+        {
+            output[i] = (unsigned char)(value & 0xFF);
+            value >>= 8;
+        }
     }
-    /* number */
-    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    else
     {
-        return parse_number(item, input_buffer);
+        for (i = bytes; i > 0; i--)
+        {
+            output[i] = (unsigned char)fmod(argument, 256.0);
+            argument = floor(argument / 256.0);
+        }
     }
-    /* array */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
+    output_buffer->offset += (size_t)bytes + 1;
+
+    return true;
+}
+
+static cJSON_bool cbor_put_bytes(printbuffer * const output_buffer, unsigned char major, const char *data, size_t length)
+{
+    unsigned char *output = NULL;
+
+    if (!cbor_put_head(output_buffer, major, (double)length))
     {
-        return parse_array(item, input_buffer);
+        return false;
     }
-    /* object */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
+    output = ensure(output_buffer, length);
+    if (output == NULL)
     {
-        return parse_object(item, input_buffer);
+        return false;
     }
+    memcpy(output, data, length);
+    output_buffer->offset += length;
 
-    return false;
+    return true;
 }
 
-/* Render a value to text. */
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+static cJSON_bool cbor_put_number(printbuffer * const output_buffer, double number)
+{
+    static const double zero = 0.0;
+    unsigned char *output = NULL;
+    float single = (float)number;
+
+    /* integers, but not -0.0 which would come back as 0 */
+    if ((number == floor(number)) && (fabs(number) <= CBOR_INTEGER_LIMIT) && !((number == 0.0) && (memcmp(&number, &zero, sizeof(number)) != 0)))
+    {
+        return (number >= 0) ? cbor_put_head(output_buffer, 0, number) : cbor_put_head(output_buffer, 1, -1.0 - number);
+    }
+
+    output = ensure(output_buffer, 9);
+    if (output == NULL)
+    {
+        return false;
+    }
+    if ((number == number) && ((double)single == number) && (sizeof(float) == 4))
+    {
+        output[0] = 0xFA;
+        cbor_swap(output + 1, (const unsigned char*)&single, 4);
+        output_buffer->offset += 5;
+    }
+    else
+    {
+        output[0] = 0xFB;
+        cbor_swap(output + 1, (const unsigned char*)&number, 8);
+        output_buffer->offset += 9;
+    }
+
+    return true;
+}
+
+static cJSON_bool cbor_encode_value(const cJSON * const item, printbuffer * const output_buffer)
 {
     unsigned char *output = NULL;
+    const cJSON *child = NULL;
+    size_t count = 0;
 
     if ((item == NULL) || (output_buffer == NULL))
     {
@@ -1389,72 +2505,971 @@ static cJSON_bool print_value(const cJSON * const item, printbuffer * const outp
     switch ((item->type) & 0xFF)
     {
         case cJSON_NULL:
-            output = ensure(output_buffer, 5);
+        case cJSON_False:
+        case cJSON_True:
+            output = ensure(output_buffer, 1);
             if (output == NULL)
             {
                 return false;
             }
-            strcpy((char*)output, "null");
+            *output = (unsigned char)((((item->type) & 0xFF) == cJSON_NULL) ? 0xF6 : (((item->type) & 0xFF) == cJSON_True) ? 0xF5 : 0xF4);
+            output_buffer->offset++;
             return true;
 
-        case cJSON_False:
-            output = ensure(output_buffer, 6);
-            if (output == NULL)
+        case cJSON_Number:
+            return cbor_put_number(output_buffer, item->valuedouble);
+
+        case cJSON_String:
+            return (item->valuestring != NULL) && cbor_put_bytes(output_buffer, 3, item->valuestring, strlen(item->valuestring));
+
+        case cJSON_Raw:
+            return (item->valuestring != NULL)
+                && cbor_put_head(output_buffer, 6, CBOR_TAG_EMBEDDED_JSON)
+                && cbor_put_bytes(output_buffer, 2, item->valuestring, strlen(item->valuestring));
+
+        case cJSON_Array:
+        case cJSON_Object:
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                count++;
+            }
+            if (!cbor_put_head(output_buffer, (((item->type) & 0xFF) == cJSON_Array) ? 4 : 5, (double)count))
             {
                 return false;
             }
-            strcpy((char*)output, "false");
+            output_buffer->depth++;
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                if (((item->type) & 0xFF) == cJSON_Object)
+                {
+                    const char *key = (child->string != NULL) ? child->string : "";
+                    if (!cbor_put_bytes(output_buffer, 3, key, strlen(key)))
+                    {
+                        return false;
+                    }
+                }
+                if (!cbor_encode_value(child, output_buffer))
+                {
+                    return false;
+                }
+            }
+            output_buffer->depth--;
             return true;
 
-        case cJSON_True:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
+        default:
+            return false;
+    }
+}
+
+CJSON_PUBLIC(unsigned char *) cJSON_PrintCBOR(const cJSON *item, size_t *length)
+{
+    unsigned char *rendered = NULL;
+    unsigned char *printed = NULL;
+    size_t size = 0;
+
+    rendered = print_into(item, cbor_encode_value, false, &print_scratch, &print_scratch_size, &size);
+    if (rendered != NULL)
+    {
+        printed = (unsigned char*)global_hooks.allocate((size > 0) ? size : 1);
+        if (printed != NULL)
+        {
+            memcpy(printed, rendered, size);
+            if (length != NULL)
+            {
+                *length = size;
+            }
+        }
+    }
+    print_buffer_trim(&print_scratch, &print_scratch_size);
+
+    return printed;
+}
+
+CJSON_PUBLIC(const unsigned char *) cJSON_PrintThreadBufferCBOR(const cJSON *item, size_t *length)
+{
+    print_buffer_trim(&print_thread_buffer, &print_thread_buffer_size);
+    return print_into(item, cbor_encode_value, false, &print_thread_buffer, &print_thread_buffer_size, length);
+}
+
+typedef struct
+{
+    const unsigned char *content;
+    size_t length;
+    size_t offset;
+    size_t depth;
+} cbor_input;
+
+/* Read an item head. Returns the major type, or -1 on malformed input; *indefinite is set
+ * for length 31 (and *argument is then meaningless). Arguments are accumulated in a double,
+ * which is exact for everything cJSON_PrintCBOR writes. */
+static int cbor_get_head(cbor_input * const input, double *argument, cJSON_bool *indefinite, unsigned char *additional)
+{
+    unsigned char initial = 0;
+    size_t bytes = 0;
+    size_t i = 0;
+
+    if (input->offset >= input->length)
+    {
+        return -1;
+    }
+    initial = input->content[input->offset++];
+    *additional = (unsigned char)(initial & 0x1F);
+    *indefinite = false;
+    *argument = 0;
+
+    if (*additional < 24)
+    {
+        *argument = *additional;
+        return initial >> 5;
+    }
+    if (*additional == 31)
+    {
+        *indefinite = true;
+        return initial >> 5;
+    }
+    if (*additional > 27)
+    {
+        return -1;
+    }
+
+    bytes = (size_t)1 << (*additional - 24);
+    if ((input->length - input->offset) < bytes)
+    {
+        return -1;
+    }
+    for (i = 0; i < bytes; i++)
+    {
+        *argument = (*argument * 256.0) + input->content[input->offset + i];
+    }
+    input->offset += bytes;
+
+    return initial >> 5;
+}
+
+static cJSON_bool cbor_is_break(const cbor_input * const input)
+{
+    return (input->offset < input->length) && (input->content[input->offset] == 0xFF);
+}
+
+/* A definite-length string body as a new NUL-terminated copy, or as an interned key when
+ * "interned" is given and interning applies (then *interned is set) */
+static char *cbor_get_string(cbor_input * const input, double length, cJSON_bool *interned)
+{
+    const char *shared = NULL;
+    char *copy = NULL;
+
+    if (length > (double)(input->length - input->offset))
+    {
+        return NULL;
+    }
+    if ((interned != NULL) && ((shared = intern_key(input->content + input->offset, (size_t)length)) != NULL))
+    {
+        *interned = true;
+        input->offset += (size_t)length;
+        return (char*)cast_away_const(shared);
+    }
+    copy = (char*)node_hooks.allocate((size_t)length + 1);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, input->content + input->offset, (size_t)length);
+    copy[(size_t)length] = '\0';
+    input->offset += (size_t)length;
+
+    return copy;
+}
+
+static double cbor_get_float(const unsigned char *bytes, unsigned char additional)
+{
+    unsigned char host[8];
+
+    if (additional == 25)
+    {
+        /* half precision */
+        int exponent = (bytes[0] >> 2) & 0x1F;
+        int mantissa = ((bytes[0] & 0x03) << 8) | bytes[1];
+        double value = 0;
+        if (exponent == 0)
+        {
+            value = ldexp((double)mantissa, -24);
+        }
+        else if (exponent != 31)
+        {
+            value = ldexp((double)(mantissa + 1024), exponent - 25);
+        }
+        else
+        {
+            value = (mantissa == 0) ? HUGE_VAL : (HUGE_VAL - HUGE_VAL);
+        }
+        return (bytes[0] & 0x80) ? -value : value;
+    }
+    if (additional == 26)
+    {
+        float single = 0;
+        cbor_swap(host, bytes, 4);
+        memcpy(&single, host, sizeof(single));
+        return (double)single;
+    }
+    {
+        double number = 0;
+        cbor_swap(host, bytes, 8);
+        memcpy(&number, host, sizeof(number));
+        return number;
+    }
+}
+
+static cJSON_bool cbor_decode_value(cJSON * const item, cbor_input * const input)
+{
+    double argument = 0;
+    cJSON_bool indefinite = false;
+    unsigned char additional = 0;
+    size_t start = input->offset;
+    int major = cbor_get_head(input, &argument, &indefinite, &additional);
+    /* an interned key stays flagged whatever happens to the value, so cJSON_Delete never frees it */
+    const int key_flags = item->type & cJSON_StringIsConst;
+
+    /* tags other than embedded JSON (e.g. epoch time) carry no meaning for cJSON: step over
+     * them to the tagged item, iteratively so a run of tags cannot exhaust the stack */
+    while ((major == 6) && !indefinite && (argument != CBOR_TAG_EMBEDDED_JSON))
+    {
+        start = input->offset;
+        major = cbor_get_head(input, &argument, &indefinite, &additional);
+    }
+
+    switch (major)
+    {
+        case 0:
+        case 1:
+            if (indefinite)
             {
                 return false;
             }
-            strcpy((char*)output, "true");
+            item->type = cJSON_Number | key_flags;
+            cJSON_SetNumberHelper(item, (major == 0) ? argument : (-1.0 - argument));
+            return true;
+
+        case 3:
+            if (indefinite)
+            {
+                return false; /* chunked strings are not supported */
+            }
+            item->valuestring = cbor_get_string(input, argument, NULL);
+            if (item->valuestring == NULL)
+            {
+                return false;
+            }
+            item->type = cJSON_String | key_flags;
+            return true;
+
+        case 4:
+        case 5:
+        {
+            cJSON *head = NULL;
+            cJSON *current = NULL;
+            double remaining = argument;
+
+            if (input->depth >= CJSON_NESTING_LIMIT)
+            {
+                return false;
+            }
+            input->depth++;
+            item->type = ((major == 4) ? cJSON_Array : cJSON_Object) | key_flags;
+            while (indefinite ? !cbor_is_break(input) : (remaining > 0))
+            {
+                cJSON *child = cJSON_New_Item(&node_hooks);
+                if (child == NULL)
+                {
+                    return false;
+                }
+                if (head == NULL)
+                {
+                    item->child = head = child;
+                }
+                else
+                {
+                    current->next = child;
+                    child->prev = current;
+                }
+                current = child;
+                head->prev = current;
+
+                if (major == 5)
+                {
+                    double key_length = 0;
+                    cJSON_bool key_indefinite = false;
+                    cJSON_bool key_interned = false;
+                    unsigned char key_additional = 0;
+                    if ((cbor_get_head(input, &key_length, &key_indefinite, &key_additional) != 3) || key_indefinite)
+                    {
+                        return false; /* only text keys map to cJSON */
+                    }
+                    child->string = cbor_get_string(input, key_length, &key_interned);
+                    if (child->string == NULL)
+                    {
+                        return false;
+                    }
+                    child->type = key_interned ? cJSON_StringIsConst : 0;
+                }
+                if (!cbor_decode_value(child, input))
+                {
+                    return false;
+                }
+                remaining -= 1;
+            }
+            if (indefinite)
+            {
+                input->offset++; /* break */
+            }
+            input->depth--;
             return true;
+        }
+
+        case 6:
+            /* embedded JSON (tag 262) */
+            if (indefinite)
+            {
+                return false;
+            }
+            if ((cbor_get_head(input, &argument, &indefinite, &additional) != 2) || indefinite)
+            {
+                return false;
+            }
+            item->valuestring = cbor_get_string(input, argument, NULL);
+            if (item->valuestring == NULL)
+            {
+                return false;
+            }
+            item->type = cJSON_Raw | key_flags;
+            return true;
+
+        case 7:
+            if ((additional >= 25) && (additional <= 27))
+            {
+                /* the head consumed the payload as an integer; reread it as a float */
+                item->type = cJSON_Number | key_flags;
+                cJSON_SetNumberHelper(item, cbor_get_float(input->content + start + 1, additional));
+                return true;
+            }
+            switch (additional)
+            {
+                case 20:
+                    item->type = cJSON_False | key_flags;
+                    return true;
+                case 21:
+                    item->type = cJSON_True | key_flags;
+                    item->valueint = 1;
+                    return true;
+                case 22:
+                case 23: /* undefined */
+                    item->type = cJSON_NULL | key_flags;
+                    return true;
+                default:
+                    return false;
+            }
+
+        default:
+            return false; /* malformed, or a byte string outside tag 262 */
+    }
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseCBOR(const unsigned char *data, size_t length)
+{
+    cbor_input input;
+    cJSON *item = NULL;
+
+    if (data == NULL)
+    {
+        return NULL;
+    }
+    input.content = data;
+    input.length = length;
+    input.offset = 0;
+    input.depth = 0;
+
+    item = cJSON_New_Item(&node_hooks);
+    if (item == NULL)
+    {
+        return NULL;
+    }
+    if (!cbor_decode_value(item, &input) || (input.offset != input.length))
+    {
+        cJSON_Delete(item);
+        return NULL;
+    }
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+
+    if ((length < 0) || (buffer == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+
+    return print_value(item, &p);
+}
+
+/* Parser core - when encountering text, process appropriately. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+{
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false; /* no input */
+    }
+
+    /* parse the different types of values */
+    /* null */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        item->type = cJSON_NULL;
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* false */
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        item->type = cJSON_False;
+        input_buffer->offset += 5;
+        return true;
+    }
+    /* true */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* string */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        return parse_string(item, input_buffer);
+    }
+    /* number */
+    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    {
+        return parse_number(item, input_buffer);
+    }
+    /* array */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
+    {
+        return parse_array(item, input_buffer);
+    }
+    /* object */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
+    {
+        return parse_object(item, input_buffer);
+    }
+
+    return false;
+}
+
+/* Render a value to text. */
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output = NULL;
+
+    if ((item == NULL) || (output_buffer == NULL))
+    {
+        return false;
+    }
+
+    switch ((item->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "null");
+            return true;
+
+        case cJSON_False:
+            output = ensure(output_buffer, 6);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "false");
+            return true;
+
+        case cJSON_True:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "true");
+            return true;
+
+        case cJSON_Number:
+            return print_number(item, output_buffer);
+
+        case cJSON_Raw:
+        {
+            size_t raw_length = 0;
+            if (item->valuestring == NULL)
+            {
+                return false;
+            }
+
+            raw_length = strlen(item->valuestring) + sizeof("");
+            output = ensure(output_buffer, raw_length);
+            if (output == NULL)
+            {
+                return false;
+            }
+            memcpy(output, item->valuestring, raw_length);
+            return true;
+        }
+
+        case cJSON_String:
+            return print_string(item, output_buffer);
+
+        case cJSON_Array:
+            return print_array(item, output_buffer);
+
+        case cJSON_Object:
+            return print_object(item, output_buffer);
+
+        default:
+            return false;
+    }
+}
+
+/* Build an array from input text. */
+static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *head = NULL; /* head of the linked list */
+    cJSON *current_item = NULL;
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (buffer_at_offset(input_buffer)[0] != '[')
+    {
+        /* not an array */
+        goto fail;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+    {
+        /* empty array */
+        goto success;
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        input_buffer->offset--;
+        goto fail;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do
+    {
+        /* allocate next item */
+        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        if (new_item == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+
+        /* attach next item to list */
+        if (head == NULL)
+        {
+            /* start the linked list */
+            current_item = head = new_item;
+        }
+        else
+        {
+            /* add to the end and advance */
+            current_item->next = new_item;
+            new_item->prev = current_item;
+            current_item = new_item;
+        }
+
+        /* parse next value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!parse_value(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    }
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+    {
+        goto fail; /* expected end of array */
+    }
+
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = cJSON_Array;
+    item->child = head;
+
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (head != NULL)
+    {
+        cJSON_Delete(head);
+    }
+
+    return false;
+}
+
+/* Render an array to text */
+static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+    cJSON *current_element = item->child;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* Compose the output array. */
+    /* opening square bracket */
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    *output_pointer = '[';
+    output_buffer->offset++;
+    output_buffer->depth++;
+
+    while (current_element != NULL)
+    {
+        if (!print_value(current_element, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+        if (current_element->next)
+        {
+            length = (size_t) (output_buffer->format ? 2 : 1);
+            output_pointer = ensure(output_buffer, length + 1);
+            if (output_pointer == NULL)
+            {
+                return false;
+            }
+            *output_pointer++ = ',';
+            if(output_buffer->format)
+            {
+                *output_pointer++ = ' ';
+            }
+            *output_pointer = '\0';
+            output_buffer->offset += length;
+        }
+        current_element = current_element->next;
+    }
+
+    output_pointer = ensure(output_buffer, 2);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer++ = ']';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Build an object from the text. */
+/* Parse an object member name into item->string. With key interning on, plain names are
+ * interned straight from the input without a temporary copy. */
+static cJSON_bool parse_key(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const char *interned = NULL;
+
+    if ((key_interning != 0) && can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        const unsigned char *start = buffer_at_offset(input_buffer) + 1;
+        const unsigned char *content_end = input_buffer->content + input_buffer->length;
+        const unsigned char *end = scan_string_special(start, content_end);
+        if ((end < content_end) && (*end == '\"'))
+        {
+            interned = intern_key(start, (size_t)(end - start));
+            if (interned != NULL)
+            {
+                item->string = (char*)cast_away_const(interned);
+                item->type |= cJSON_StringIsConst;
+                input_buffer->offset = (size_t)(end + 1 - input_buffer->content);
+                return true;
+            }
+        }
+    }
+
+    if (!parse_string(item, input_buffer))
+    {
+        return false;
+    }
+
+    /* swap valuestring and string, because we parsed the name */
+    item->string = item->valuestring;
+    item->valuestring = NULL;
+
+    if ((key_interning != 0) && ((interned = intern_key((const unsigned char*)item->string, strlen(item->string))) != NULL))
+    {
+        input_buffer->hooks.deallocate(item->string);
+        item->string = (char*)cast_away_const(interned);
+        item->type |= cJSON_StringIsConst;
+    }
+
+    return true;
+}
+
+static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *head = NULL; /* linked list head */
+    cJSON *current_item = NULL;
+    int key_flags = 0;
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
+    {
+        goto fail; /* not an object */
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
+    {
+        goto success; /* empty object */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        input_buffer->offset--;
+        goto fail;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do
+    {
+        /* allocate next item */
+        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        if (new_item == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+
+        /* attach next item to list */
+        if (head == NULL)
+        {
+            /* start the linked list */
+            current_item = head = new_item;
+        }
+        else
+        {
+            /* add to the end and advance */
+            current_item->next = new_item;
+            new_item->prev = current_item;
+            current_item = new_item;
+        }
+
+        if (cannot_access_at_index(input_buffer, 1))
+        {
+            goto fail; /* nothing comes after the comma */
+        }
+
+        /* parse the name of the child */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!parse_key(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        {
+            goto fail; /* invalid object */
+        }
+
+        /* parse the value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        key_flags = current_item->type & cJSON_StringIsConst;
+        if (!parse_value(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse value */
+        }
+        current_item->type |= key_flags;
+        buffer_skip_whitespace(input_buffer);
+    }
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    {
+        goto fail; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = cJSON_Object;
+    item->child = head;
+
+    input_buffer->offset++;
+    return true;
+
+fail:
+    if (head != NULL)
+    {
+        cJSON_Delete(head);
+    }
+
+    return false;
+}
+
+/* Event-driven parsing. Containers are reported as start/end events and scalars as
+ * value events carrying a temporary cJSON item built by the regular parse_value, so
+ * numbers and strings decode exactly as in cJSON_Parse. The callback can skip a
+ * container (scanned for structure only, nothing allocated) or have it materialized
+ * as one cJSON subtree. */
+typedef struct
+{
+    cJSON_SAX_Callback callback;
+    void *user_data;
+    cJSON_bool aborted;
+} sax_context;
+
+/* step over one value without building anything; checks bracket and quote balance only */
+static cJSON_bool skip_value(parse_buffer * const input_buffer)
+{
+    const unsigned char *end = input_buffer->content + input_buffer->length;
+    size_t depth = 0;
+
+    do
+    {
+        const unsigned char *pointer = NULL;
+
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0))
+        {
+            return false;
+        }
+        pointer = buffer_at_offset(input_buffer);
+        switch (*pointer)
+        {
+            case '\"':
+                pointer++;
+                for (;;)
+                {
+                    pointer = scan_string_special(pointer, end);
+                    if ((pointer >= end) || (*pointer == '\"'))
+                    {
+                        break;
+                    }
+                    pointer += 2; /* escape sequence */
+                }
+                if (pointer >= end)
+                {
+                    return false;
+                }
+                input_buffer->offset = (size_t)(pointer + 1 - input_buffer->content);
+                break;
+
+            case '{':
+            case '[':
+                if (depth >= CJSON_NESTING_LIMIT)
+                {
+                    return false;
+                }
+                depth++;
+                input_buffer->offset++;
+                break;
 
-        case cJSON_Number:
-            return print_number(item, output_buffer);
+            case '}':
+            case ']':
+                if (depth == 0)
+                {
+                    return false;
+                }
+                depth--;
+                input_buffer->offset++;
+                break;
 
-        case cJSON_Raw:
-        {
-            size_t raw_length = 0;
-            if (item->valuestring == NULL)
-            {
-                return false;
-            }
+            case ',':
+            case ':':
+                if (depth == 0)
+                {
+                    return false;
+                }
+                input_buffer->offset++;
+                break;
 
-            raw_length = strlen(item->valuestring) + sizeof("");
-            output = ensure(output_buffer, raw_length);
-            if (output == NULL)
-            {
+            case '\0':
                 return false;
-            }
-            memcpy(output, item->valuestring, raw_length);
-            return true;
-        }
-
-        case cJSON_String:
-            return print_string(item, output_buffer);
 
-        case cJSON_Array:
-            return print_array(item, output_buffer);
-
-        case cJSON_Object:
-            return print_object(item, output_buffer);
+            default:
+                /* number or literal */
+                while ((pointer < end) && (*pointer > 32) && (strchr(",:]}\"", *pointer) == NULL))
+                {
+                    pointer++;
+                }
+                input_buffer->offset = (size_t)(pointer - input_buffer->content);
+                break;
+        }
+    } while (depth > 0);
 
-        default:
-            return false;
-    }
+    return true;
 }
 
-/* Build an array from input text. */
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+static cJSON_bool sax_parse_value(parse_buffer * const input_buffer, sax_context * const context, const char *key);
+
+static cJSON_bool sax_parse_container(parse_buffer * const input_buffer, sax_context * const context, const char *key)
 {
-    cJSON *head = NULL; /* head of the linked list */
-    cJSON *current_item = NULL;
+    const unsigned char opening = buffer_at_offset(input_buffer)[0];
+    const unsigned char closing = (opening == '{') ? '}' : ']';
+    cJSON *name = NULL;
 
     if (input_buffer->depth >= CJSON_NESTING_LIMIT)
     {
@@ -1462,270 +3477,412 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
     }
     input_buffer->depth++;
 
-    if (buffer_at_offset(input_buffer)[0] != '[')
-    {
-        /* not an array */
-        goto fail;
-    }
-
     input_buffer->offset++;
     buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == closing))
     {
-        /* empty array */
-        goto success;
+        goto success; /* empty container */
     }
 
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+    for (;;)
     {
-        input_buffer->offset--;
-        goto fail;
-    }
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0))
+        {
+            goto fail;
+        }
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
-    {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        if (opening == '{')
         {
-            goto fail; /* allocation failure */
+            /* parse the name of the child */
+            name = cJSON_New_Item(&(input_buffer->hooks));
+            if ((name == NULL) || !parse_string(name, input_buffer))
+            {
+                goto fail;
+            }
+            buffer_skip_whitespace(input_buffer);
+            if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+            {
+                goto fail; /* invalid object */
+            }
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
         }
 
-        /* attach next item to list */
-        if (head == NULL)
+        if (!sax_parse_value(input_buffer, context, (name != NULL) ? name->valuestring : NULL))
         {
-            /* start the linked list */
-            current_item = head = new_item;
+            goto fail;
         }
-        else
+        if (name != NULL)
         {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
+            cJSON_Delete(name);
+            name = NULL;
         }
 
-        /* parse next value */
-        input_buffer->offset++;
         buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        if (cannot_access_at_index(input_buffer, 0))
         {
-            goto fail; /* failed to parse value */
+            goto fail;
         }
-        buffer_skip_whitespace(input_buffer);
+        if (buffer_at_offset(input_buffer)[0] == closing)
+        {
+            break;
+        }
+        if (buffer_at_offset(input_buffer)[0] != ',')
+        {
+            goto fail; /* expected end of container */
+        }
+        input_buffer->offset++;
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    if (context->callback((opening == '{') ? cJSON_SAX_ObjectEnd : cJSON_SAX_ArrayEnd, key, NULL, context->user_data) == cJSON_SAX_Abort)
     {
-        goto fail; /* expected end of array */
+        context->aborted = true;
+        return false;
     }
+    return true;
 
-success:
-    input_buffer->depth--;
+fail:
+    if (name != NULL)
+    {
+        cJSON_Delete(name);
+    }
+    return false;
+}
 
-    if (head != NULL) {
-        head->prev = current_item;
+static cJSON_bool sax_parse_value(parse_buffer * const input_buffer, sax_context * const context, const char *key)
+{
+    cJSON_SAX_Action action = cJSON_SAX_Continue;
+    cJSON *item = NULL;
+
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        return false;
     }
 
-    item->type = cJSON_Array;
-    item->child = head;
+    if ((buffer_at_offset(input_buffer)[0] == '{') || (buffer_at_offset(input_buffer)[0] == '['))
+    {
+        action = context->callback((buffer_at_offset(input_buffer)[0] == '{') ? cJSON_SAX_ObjectStart : cJSON_SAX_ArrayStart, key, NULL, context->user_data);
+        switch (action)
+        {
+            case cJSON_SAX_Abort:
+                context->aborted = true;
+                return false;
+            case cJSON_SAX_Skip:
+                return skip_value(input_buffer);
+            case cJSON_SAX_Materialize:
+                break;
+            default:
+                return sax_parse_container(input_buffer, context, key);
+        }
+    }
 
-    input_buffer->offset++;
+    /* scalar, or a container the callback wants as a whole */
+    item = cJSON_New_Item(&(input_buffer->hooks));
+    if (item == NULL)
+    {
+        return false;
+    }
+    if (!parse_value(item, input_buffer))
+    {
+        cJSON_Delete(item);
+        return false;
+    }
+
+    action = context->callback(cJSON_SAX_Value, key, item, context->user_data);
+    if (action != cJSON_SAX_Take)
+    {
+        cJSON_Delete(item);
+    }
+    if (action == cJSON_SAX_Abort)
+    {
+        context->aborted = true;
+        return false;
+    }
 
     return true;
+}
 
-fail:
-    if (head != NULL)
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseSAX(const char *value, cJSON_SAX_Callback callback, void *user_data)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    sax_context context;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (callback == NULL))
     {
-        cJSON_Delete(head);
+        return false;
+    }
+
+    buffer.content = (const unsigned char*)value;
+    buffer.length = strlen(value) + sizeof("");
+    buffer.offset = 0;
+    buffer.hooks = node_hooks;
+
+    context.callback = callback;
+    context.user_data = user_data;
+    context.aborted = false;
+
+    if (sax_parse_value(buffer_skip_whitespace(skip_utf8_bom(&buffer)), &context, NULL))
+    {
+        return true;
+    }
+
+    if (!context.aborted)
+    {
+        global_error.json = (const unsigned char*)value;
+        global_error.position = (buffer.offset < buffer.length) ? buffer.offset : buffer.length - 1;
     }
 
     return false;
 }
 
-/* Render an array to text */
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+/* Path selection: only the selected members are built. Keys are read into the path
+ * buffer without allocating, and members that are neither selected nor on the way to
+ * a selection are stepped over with skip_value, so they are checked for bracket and
+ * quote balance only. Every object the walk descends into is mirrored in the result. */
+#define SELECT_MAX_PATH 256
+#define SELECT_MAX_DEPTH 64
+
+typedef struct
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_element = item->child;
+    const char * const *paths;
+    int count;
+    char path[SELECT_MAX_PATH];
+} select_context;
 
-    if (output_buffer == NULL)
+/* 2: path selected, 1: a selected path lies below it, 0: neither */
+static int select_match(const select_context * const context, size_t length)
+{
+    int result = 0;
+    int i = 0;
+
+    for (i = 0; i < context->count; i++)
     {
-        return false;
+        const char *candidate = context->paths[i];
+        if ((candidate == NULL) || (strncmp(candidate, context->path, length) != 0))
+        {
+            continue;
+        }
+        if (candidate[length] == '\0')
+        {
+            return 2;
+        }
+        if (candidate[length] == '.')
+        {
+            result = 1;
+        }
     }
 
-    /* Compose the output array. */
-    /* opening square bracket */
-    output_pointer = ensure(output_buffer, 1);
-    if (output_pointer == NULL)
+    return result;
+}
+
+/* read the key at the offset and append it to the path at parent_length. length gets
+ * the new path length, or 0 if the key does not fit (it is still consumed). */
+static cJSON_bool select_parse_key(parse_buffer * const input_buffer, select_context * const context, size_t parent_length, size_t * const length)
+{
+    const unsigned char *start = buffer_at_offset(input_buffer) + 1;
+    const unsigned char *end = input_buffer->content + input_buffer->length;
+    const unsigned char *pointer = NULL;
+    const char *key = NULL;
+    size_t key_length = 0;
+    cJSON escaped;
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
     {
         return false;
     }
 
-    *output_pointer = '[';
-    output_buffer->offset++;
-    output_buffer->depth++;
-
-    while (current_element != NULL)
+    memset(&escaped, '\0', sizeof(cJSON));
+    pointer = scan_string_special(start, end);
+    if ((pointer < end) && (*pointer == '\"'))
     {
-        if (!print_value(current_element, output_buffer))
+        /* plain key: use the bytes in place */
+        key = (const char*)start;
+        key_length = (size_t)(pointer - start);
+        input_buffer->offset = (size_t)(pointer + 1 - input_buffer->content);
+    }
+    else
+    {
+        /* escape sequences: decode them the way parse_string does */
+        if (!parse_string(&escaped, input_buffer))
         {
             return false;
         }
-        update_offset(output_buffer);
-        if (current_element->next)
+        key = escaped.valuestring;
+        key_length = strlen(key);
+    }
+
+    *length = parent_length + ((parent_length > 0) ? 1 : 0) + key_length;
+    if (*length < SELECT_MAX_PATH)
+    {
+        if (parent_length > 0)
         {
-            length = (size_t) (output_buffer->format ? 2 : 1);
-            output_pointer = ensure(output_buffer, length + 1);
-            if (output_pointer == NULL)
-            {
-                return false;
-            }
-            *output_pointer++ = ',';
-            if(output_buffer->format)
-            {
-                *output_pointer++ = ' ';
-            }
-            *output_pointer = '\0';
-            output_buffer->offset += length;
+            context->path[parent_length] = '.';
         }
-        current_element = current_element->next;
+        memcpy(context->path + *length - key_length, key, key_length);
+        context->path[*length] = '\0';
+    }
+    else
+    {
+        *length = 0;
     }
 
-    output_pointer = ensure(output_buffer, 2);
-    if (output_pointer == NULL)
+    if (escaped.valuestring != NULL)
     {
-        return false;
+        input_buffer->hooks.deallocate(escaped.valuestring);
     }
-    *output_pointer++ = ']';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
     return true;
 }
 
-/* Build an object from the text. */
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
+/* parse the object at the offset into output, whose path is context->path[0..parent_length) */
+static cJSON_bool select_parse_object(parse_buffer * const input_buffer, select_context * const context, cJSON * const output, size_t parent_length)
 {
-    cJSON *head = NULL; /* linked list head */
-    cJSON *current_item = NULL;
+    const char *key = context->path + parent_length + ((parent_length > 0) ? 1 : 0);
+    size_t length = 0;
+    int match = 0;
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    if (input_buffer->depth >= SELECT_MAX_DEPTH)
     {
         return false; /* to deeply nested */
     }
     input_buffer->depth++;
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
-    {
-        goto fail; /* not an object */
-    }
-
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
-    {
-        goto success; /* empty object */
-    }
-
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
     {
-        input_buffer->offset--;
-        goto fail;
+        goto success; /* empty object */
     }
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
+    for (;;)
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        buffer_skip_whitespace(input_buffer);
+        if (!select_parse_key(input_buffer, context, parent_length, &length))
         {
-            goto fail; /* allocation failure */
+            return false;
         }
-
-        /* attach next item to list */
-        if (head == NULL)
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
         {
-            /* start the linked list */
-            current_item = head = new_item;
+            return false; /* invalid object */
         }
-        else
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0))
         {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
+            return false;
         }
 
-        if (cannot_access_at_index(input_buffer, 1))
+        match = (length > 0) ? select_match(context, length) : 0;
+        if (match == 2)
         {
-            goto fail; /* nothing comes after the comma */
+            cJSON *item = cJSON_New_Item(&(input_buffer->hooks));
+            if ((item == NULL) || !parse_value(item, input_buffer))
+            {
+                cJSON_Delete(item);
+                return false;
+            }
+            cJSON_AddItemToObject(output, key, item);
         }
-
-        /* parse the name of the child */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_string(current_item, input_buffer))
+        else if ((match == 1) && (buffer_at_offset(input_buffer)[0] == '{'))
         {
-            goto fail; /* failed to parse name */
+            cJSON *object = cJSON_AddObjectToObject(output, key);
+            if ((object == NULL) || !select_parse_object(input_buffer, context, object, length))
+            {
+                return false;
+            }
         }
-        buffer_skip_whitespace(input_buffer);
-
-        /* swap valuestring and string, because we parsed the name */
-        current_item->string = current_item->valuestring;
-        current_item->valuestring = NULL;
-
-        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        else if (!skip_value(input_buffer))
         {
-            goto fail; /* invalid object */
+            return false;
         }
+        context->path[parent_length] = '\0';
 
-        /* parse the value */
-        input_buffer->offset++;
         buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        if (cannot_access_at_index(input_buffer, 0))
         {
-            goto fail; /* failed to parse value */
+            return false;
         }
-        buffer_skip_whitespace(input_buffer);
+        if (buffer_at_offset(input_buffer)[0] == '}')
+        {
+            break;
+        }
+        if (buffer_at_offset(input_buffer)[0] != ',')
+        {
+            return false; /* expected end of object */
+        }
+        input_buffer->offset++;
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseSelect(const char *value, const char * const *paths, int count)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    select_context *context = NULL;
+    cJSON *result = NULL;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (paths == NULL) || (count <= 0))
     {
-        goto fail; /* expected end of object */
+        return NULL;
     }
 
-success:
-    input_buffer->depth--;
+    buffer.content = (const unsigned char*)value;
+    buffer.length = strlen(value) + sizeof("");
+    buffer.offset = 0;
+    buffer.hooks = node_hooks;
 
-    if (head != NULL) {
-        head->prev = current_item;
+    /* only an object can hold named paths */
+    buffer_skip_whitespace(skip_utf8_bom(&buffer));
+    if (cannot_access_at_index(&buffer, 0) || (buffer_at_offset(&buffer)[0] != '{'))
+    {
+        goto fail;
     }
 
-    item->type = cJSON_Object;
-    item->child = head;
+    context = (select_context*)global_hooks.allocate(sizeof(select_context));
+    result = cJSON_CreateObject();
+    if ((context == NULL) || (result == NULL))
+    {
+        goto fail;
+    }
+    context->paths = paths;
+    context->count = count;
+    context->path[0] = '\0';
 
-    input_buffer->offset++;
-    return true;
+    if (select_parse_object(&buffer, context, result, 0))
+    {
+        global_hooks.deallocate(context);
+        return result;
+    }
 
 fail:
-    if (head != NULL)
+    global_error.json = (const unsigned char*)value;
+    global_error.position = (buffer.offset < buffer.length) ? buffer.offset : buffer.length - 1;
+    if (context != NULL)
     {
-        cJSON_Delete(head);
+        global_hooks.deallocate(context);
     }
+    cJSON_Delete(result);
 
-    return false;
+    return NULL;
 }
 
 /* Render an object to text. */
@@ -1895,26 +4052,312 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+/* Optional key index for large objects.
+ * When an add or insert takes an object past index_threshold children, a hash of
+ * its keys is built and kept in the object's index field. Lookups only read it, so
+ * it is created and changed solely by writers. The add, insert, replace and detach
+ * functions keep it in sync; cJSON_Delete releases it. Objects with keyless children
+ * or keys that collide case-insensitively fall back to the linear scan, so lookups
+ * always return the same item as without the index. */
+struct cJSON_Index
+{
+    cJSON **slots;
+    size_t capacity; /* power of two */
+    size_t count;
+    cJSON_bool disabled;
+};
+
+static size_t index_threshold = 0;
+
+CJSON_PUBLIC(void) cJSON_SetIndexThreshold(size_t children)
+{
+    index_threshold = children;
+}
+
+static object_index *get_object_index(const cJSON * const object)
+{
+    if ((object == NULL) || ((object->type & 0xFF) != cJSON_Object))
+    {
+        return NULL;
+    }
+
+    return object->index;
+}
+
+static size_t index_hash(const unsigned char *key)
+{
+    /* FNV-1a over lowercased bytes, matching case_insensitive_strcmp */
+    size_t hash = (size_t)2166136261U;
+    for (; *key != '\0'; key++)
+    {
+        hash ^= (size_t)tolower(*key);
+        hash *= (size_t)16777619U;
+    }
+
+    return hash;
+}
+
+static void index_release(object_index *index)
+{
+    if (index != NULL)
+    {
+        if (index->slots != NULL)
+        {
+            global_hooks.deallocate(index->slots);
+        }
+        global_hooks.deallocate(index);
+    }
+}
+
+static void index_disable(object_index *index)
+{
+    if (index->slots != NULL)
+    {
+        global_hooks.deallocate(index->slots);
+        index->slots = NULL;
+    }
+    index->capacity = 0;
+    index->count = 0;
+    index->disabled = true;
+}
+
+static cJSON_bool index_resize(object_index *index, size_t capacity);
+
+static void index_insert(object_index *index, cJSON *item)
+{
+    size_t mask = 0;
+    size_t position = 0;
+
+    if ((index == NULL) || index->disabled)
+    {
+        return;
+    }
+    if (item->string == NULL)
+    {
+        index_disable(index);
+        return;
+    }
+    if (((index->count + 1) * 2 > index->capacity) && !index_resize(index, index->capacity * 2))
+    {
+        index_disable(index);
+    }
+    if (index->disabled)
+    {
+        return;
+    }
+
+    mask = index->capacity - 1;
+    position = index_hash((const unsigned char*)item->string) & mask;
+    while (index->slots[position] != NULL)
+    {
+        if (case_insensitive_strcmp((const unsigned char*)index->slots[position]->string, (const unsigned char*)item->string) == 0)
+        {
+            /* ambiguous key: first-match semantics need the list order */
+            index_disable(index);
+            return;
+        }
+        position = (position + 1) & mask;
+    }
+    index->slots[position] = item;
+    index->count++;
+}
+
+static cJSON_bool index_resize(object_index *index, size_t capacity)
+{
+    cJSON **old_slots = index->slots;
+    size_t old_capacity = index->capacity;
+    size_t i = 0;
+
+    size_t rounded = 16;
+
+    while (rounded < capacity)
+    {
+        rounded *= 2;
+    }
+    capacity = rounded;
+    index->slots = (cJSON**)global_hooks.allocate(capacity * sizeof(cJSON*));
+    if (index->slots == NULL)
+    {
+        index->slots = old_slots;
+        return false;
+    }
+    memset(index->slots, '\0', capacity * sizeof(cJSON*));
+    index->capacity = capacity;
+    index->count = 0;
+
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (old_slots[i] != NULL)
+        {
+            index_insert(index, old_slots[i]);
+        }
+    }
+    if (old_slots != NULL)
+    {
+        global_hooks.deallocate(old_slots);
+    }
+
+    return true;
+}
+
+static void index_remove(object_index *index, const cJSON *item)
+{
+    size_t mask = 0;
+    size_t position = 0;
+    size_t next = 0;
+    size_t home = 0;
+
+    if ((index == NULL) || index->disabled || (item->string == NULL))
+    {
+        return;
+    }
+
+    mask = index->capacity - 1;
+    position = index_hash((const unsigned char*)item->string) & mask;
+    while ((index->slots[position] != NULL) && (index->slots[position] != item))
+    {
+        position = (position + 1) & mask;
+    }
+    if (index->slots[position] == NULL)
+    {
+        return;
+    }
+
+    /* backward-shift deletion keeps probe chains intact without tombstones */
+    index->slots[position] = NULL;
+    index->count--;
+    next = (position + 1) & mask;
+    while (index->slots[next] != NULL)
+    {
+        home = index_hash((const unsigned char*)index->slots[next]->string) & mask;
+        if (((next - home) & mask) >= ((next - position) & mask))
+        {
+            index->slots[position] = index->slots[next];
+            index->slots[next] = NULL;
+            position = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+static object_index *index_build(cJSON * const object)
+{
+    object_index *index = NULL;
+    cJSON *child = NULL;
+    size_t count = 0;
+
+    /* arena objects are short-lived; never tie heap memory to them */
+    if ((object->type & cJSON_IsReference) || ((current_arena != NULL) && arena_owns(object)))
+    {
+        return NULL;
+    }
+
+    index = (object_index*)global_hooks.allocate(sizeof(object_index));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    memset(index, '\0', sizeof(object_index));
+
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        count++;
+    }
+    if (!index_resize(index, count * 2))
+    {
+        index_disable(index);
+    }
+    for (child = object->child; (child != NULL) && !index->disabled; child = child->next)
+    {
+        index_insert(index, child);
+    }
+
+    object->index = index;
+
+    return index;
+}
+
+/* Called after item was linked into object: index it, or build the index once the
+ * object has grown past the threshold */
+static void index_track(cJSON * const object, cJSON * const item)
+{
+    object_index *index = get_object_index(object);
+    const cJSON *child = NULL;
+    size_t count = 0;
+
+    if (index != NULL)
+    {
+        index_insert(index, item);
+        return;
+    }
+    if ((index_threshold == 0) || (object == NULL) || ((object->type & 0xFF) != cJSON_Object))
+    {
+        return;
+    }
+
+    for (child = object->child; (child != NULL) && (count <= index_threshold); child = child->next)
+    {
+        count++;
+    }
+    if (count > index_threshold)
+    {
+        index_build(object);
+    }
+}
+
+static cJSON *index_lookup(const object_index *index, const char * const name, const cJSON_bool case_sensitive)
+{
+    size_t mask = index->capacity - 1;
+    size_t position = index_hash((const unsigned char*)name) & mask;
+    cJSON *candidate = NULL;
+
+    while ((candidate = index->slots[position]) != NULL)
+    {
+        if (candidate->string == name)
+        {
+            return candidate;
+        }
+        if (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)candidate->string) == 0)
+        {
+            if (case_sensitive && (strcmp(name, candidate->string) != 0))
+            {
+                return NULL;
+            }
+            return candidate;
+        }
+        position = (position + 1) & mask;
+    }
+
+    return NULL;
+}
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    object_index *index = NULL;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+    index = get_object_index(object);
+    if ((index != NULL) && !index->disabled)
+    {
+        return index_lookup(index, name, case_sensitive);
+    }
+
     current_element = object->child;
     if (case_sensitive)
     {
-        while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
+        while ((current_element != NULL) && (current_element->string != NULL) && (name != current_element->string) && (strcmp(name, current_element->string) != 0))
         {
             current_element = current_element->next;
         }
     }
     else
     {
-        while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+        while ((current_element != NULL) && (name != current_element->string) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
         {
             current_element = current_element->next;
         }
@@ -2000,6 +4443,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
             array->child->prev = item;
         }
     }
+    index_track(array, item);
 
     return true;
 }
@@ -2041,6 +4485,10 @@ static cJSON_bool add_item_to_object(cJSON * const object, const char * const st
         new_key = (char*)cast_away_const(string);
         new_type = item->type | cJSON_StringIsConst;
     }
+    else if ((key_interning != 0) && ((new_key = (char*)cast_away_const(intern_key((const unsigned char*)string, strlen(string)))) != NULL))
+    {
+        new_type = item->type | cJSON_StringIsConst;
+    }
     else
     {
         new_key = (char*)cJSON_strdup((const unsigned char*)string, hooks);
@@ -2065,13 +4513,13 @@ static cJSON_bool add_item_to_object(cJSON * const object, const char * const st
 
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
 {
-    return add_item_to_object(object, string, item, &global_hooks, false);
+    return add_item_to_object(object, string, item, &node_hooks, false);
 }
 
 /* Add an item to an object with constant string as key */
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObjectCS(cJSON *object, const char *string, cJSON *item)
 {
-    return add_item_to_object(object, string, item, &global_hooks, true);
+    return add_item_to_object(object, string, item, &node_hooks, true);
 }
 
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item)
@@ -2081,7 +4529,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item
         return false;
     }
 
-    return add_item_to_array(array, create_reference(item, &global_hooks));
+    return add_item_to_array(array, create_reference(item, &node_hooks));
 }
 
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToObject(cJSON *object, const char *string, cJSON *item)
@@ -2091,13 +4539,13 @@ CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToObject(cJSON *object, const cha
         return false;
     }
 
-    return add_item_to_object(object, string, create_reference(item, &global_hooks), &global_hooks, false);
+    return add_item_to_object(object, string, create_reference(item, &node_hooks), &node_hooks, false);
 }
 
 CJSON_PUBLIC(cJSON*) cJSON_AddNullToObject(cJSON * const object, const char * const name)
 {
     cJSON *null = cJSON_CreateNull();
-    if (add_item_to_object(object, name, null, &global_hooks, false))
+    if (add_item_to_object(object, name, null, &node_hooks, false))
     {
         return null;
     }
@@ -2109,7 +4557,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddNullToObject(cJSON * const object, const char * co
 CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * const name)
 {
     cJSON *true_item = cJSON_CreateTrue();
-    if (add_item_to_object(object, name, true_item, &global_hooks, false))
+    if (add_item_to_object(object, name, true_item, &node_hooks, false))
     {
         return true_item;
     }
@@ -2121,7 +4569,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * co
 CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * const name)
 {
     cJSON *false_item = cJSON_CreateFalse();
-    if (add_item_to_object(object, name, false_item, &global_hooks, false))
+    if (add_item_to_object(object, name, false_item, &node_hooks, false))
     {
         return false_item;
     }
@@ -2133,7 +4581,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * c
 CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean)
 {
     cJSON *bool_item = cJSON_CreateBool(boolean);
-    if (add_item_to_object(object, name, bool_item, &global_hooks, false))
+    if (add_item_to_object(object, name, bool_item, &node_hooks, false))
     {
         return bool_item;
     }
@@ -2145,7 +4593,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * co
 CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number)
 {
     cJSON *number_item = cJSON_CreateNumber(number);
-    if (add_item_to_object(object, name, number_item, &global_hooks, false))
+    if (add_item_to_object(object, name, number_item, &node_hooks, false))
     {
         return number_item;
     }
@@ -2157,7 +4605,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char *
 CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string)
 {
     cJSON *string_item = cJSON_CreateString(string);
-    if (add_item_to_object(object, name, string_item, &global_hooks, false))
+    if (add_item_to_object(object, name, string_item, &node_hooks, false))
     {
         return string_item;
     }
@@ -2169,7 +4617,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char *
 CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * const name, const char * const raw)
 {
     cJSON *raw_item = cJSON_CreateRaw(raw);
-    if (add_item_to_object(object, name, raw_item, &global_hooks, false))
+    if (add_item_to_object(object, name, raw_item, &node_hooks, false))
     {
         return raw_item;
     }
@@ -2181,7 +4629,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * con
 CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char * const name)
 {
     cJSON *object_item = cJSON_CreateObject();
-    if (add_item_to_object(object, name, object_item, &global_hooks, false))
+    if (add_item_to_object(object, name, object_item, &node_hooks, false))
     {
         return object_item;
     }
@@ -2193,7 +4641,7 @@ CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char *
 CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name)
 {
     cJSON *array = cJSON_CreateArray();
-    if (add_item_to_object(object, name, array, &global_hooks, false))
+    if (add_item_to_object(object, name, array, &node_hooks, false))
     {
         return array;
     }
@@ -2209,6 +4657,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
+    index_remove(get_object_index(parent), item);
+
     if (item != parent->child)
     {
         /* not the first element */
@@ -2309,6 +4759,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
     {
         newitem->prev->next = newitem;
     }
+    index_track(array, newitem);
     return true;
 }
 
@@ -2324,6 +4775,8 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    index_remove(get_object_index(parent), item);
+
     replacement->next = item->next;
     replacement->prev = item->prev;
 
@@ -2354,6 +4807,8 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         }
     }
 
+    index_insert(get_object_index(parent), replacement);
+
     item->next = NULL;
     item->prev = NULL;
     cJSON_Delete(item);
@@ -2383,7 +4838,7 @@ static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSO
     {
         cJSON_free(replacement->string);
     }
-    replacement->string = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+    replacement->string = (char*)cJSON_strdup((const unsigned char*)string, &node_hooks);
     if (replacement->string == NULL)
     {
         return false;
@@ -2407,7 +4862,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object, c
 /* Create basic types: */
 CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_NULL;
@@ -2418,7 +4873,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_True;
@@ -2429,7 +4884,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_False;
@@ -2440,7 +4895,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = boolean ? cJSON_True : cJSON_False;
@@ -2451,7 +4906,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_Number;
@@ -2477,11 +4932,11 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_String;
-        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, &node_hooks);
         if(!item->valuestring)
         {
             cJSON_Delete(item);
@@ -2494,7 +4949,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if (item != NULL)
     {
         item->type = cJSON_String | cJSON_IsReference;
@@ -2506,7 +4961,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if (item != NULL) {
         item->type = cJSON_Object | cJSON_IsReference;
         item->child = (cJSON*)cast_away_const(child);
@@ -2516,7 +4971,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
 }
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child) {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if (item != NULL) {
         item->type = cJSON_Array | cJSON_IsReference;
         item->child = (cJSON*)cast_away_const(child);
@@ -2527,11 +4982,11 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child) {
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type = cJSON_Raw;
-        item->valuestring = (char*)cJSON_strdup((const unsigned char*)raw, &global_hooks);
+        item->valuestring = (char*)cJSON_strdup((const unsigned char*)raw, &node_hooks);
         if(!item->valuestring)
         {
             cJSON_Delete(item);
@@ -2544,7 +4999,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateArray(void)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if(item)
     {
         item->type=cJSON_Array;
@@ -2555,7 +5010,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateArray(void)
 
 CJSON_PUBLIC(cJSON *) cJSON_CreateObject(void)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(&node_hooks);
     if (item)
     {
         item->type = cJSON_Object;
@@ -2739,7 +5194,7 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
         goto fail;
     }
     /* Create new item */
-    newitem = cJSON_New_Item(&global_hooks);
+    newitem = cJSON_New_Item(&node_hooks);
     if (!newitem)
     {
         goto fail;
@@ -2748,9 +5203,9 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     newitem->type = item->type & (~cJSON_IsReference);
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
-    if (item->valuestring)
+    if (item->valuestring && ((item->type & 0xFF) != cJSON_Object))
     {
-        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
+        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &node_hooks);
         if (!newitem->valuestring)
         {
             goto fail;
@@ -2758,7 +5213,16 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     }
     if (item->string)
     {
-        newitem->string = (item->type&cJSON_StringIsConst) ? item->string : (char*)cJSON_strdup((unsigned char*)item->string, &global_hooks);
+        if ((item->type & cJSON_StringIsConst) && !((current_arena != NULL) && arena_owns(item->string)))
+        {
+            newitem->string = item->string;
+        }
+        else
+        {
+            /* keys interned in an arena must not outlive it */
+            newitem->string = (char*)cJSON_strdup((unsigned char*)item->string, &node_hooks);
+            newitem->type &= ~cJSON_StringIsConst;
+        }
         if (!newitem->string)
         {
             goto fail;
@@ -3138,6 +5602,6 @@ CJSON_PUBLIC(void *) cJSON_malloc(size_t size)
 
 CJSON_PUBLIC(void) cJSON_free(void *object)
 {
-    global_hooks.deallocate(object);
+    node_hooks.deallocate(object);
     object = NULL;
 }
\ No newline at end of file
@@ -120,6 +120,9 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+    /* Key index of a large object, see cJSON_SetIndexThreshold. Managed by cJSON. */
+    struct cJSON_Index *index;
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -152,6 +155,38 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Event-driven parsing. The callback sees ObjectStart/ArrayStart before a container's members,
+ * ObjectEnd/ArrayEnd after them, and a Value event for every scalar with a temporary item holding
+ * it. key is the member name, or NULL inside arrays and for the root.
+ * Return Continue to go on, Skip on a start event to step over the container without building
+ * anything, Materialize on a start event to receive the whole container as one Value event,
+ * Take on a Value event to keep the item (the caller then owns it), or Abort to stop.
+ * Skipped containers are only checked for bracket and quote balance. Returns 1 if the whole
+ * value was parsed; on syntax errors cJSON_GetErrorPtr() is set as for cJSON_Parse. */
+typedef enum
+{
+    cJSON_SAX_Value,
+    cJSON_SAX_ObjectStart,
+    cJSON_SAX_ObjectEnd,
+    cJSON_SAX_ArrayStart,
+    cJSON_SAX_ArrayEnd
+} cJSON_SAX_Event;
+typedef enum
+{
+    cJSON_SAX_Continue,
+    cJSON_SAX_Skip,
+    cJSON_SAX_Materialize,
+    cJSON_SAX_Take,
+    cJSON_SAX_Abort
+} cJSON_SAX_Action;
+typedef cJSON_SAX_Action (*cJSON_SAX_Callback)(cJSON_SAX_Event event, const char *key, cJSON *value, void *user_data);
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseSAX(const char *value, cJSON_SAX_Callback callback, void *user_data);
+/* Parse only the members named by dot-separated, case-sensitive object paths (e.g. "data.areaList").
+ * Returns an object holding each selected subtree at its original position, or NULL if value is
+ * not a valid JSON object. Members off the selected paths are stepped over without allocating and
+ * are only checked for bracket and quote balance. Delete the result with cJSON_Delete. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseSelect(const char *value, const char * const *paths, int count);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -161,6 +196,32 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Reusable print buffers: render into storage that is kept and grown between calls instead of
+ * allocating a fresh string per print. Both return the NUL-terminated text (length excludes the NUL)
+ * or NULL on failure, and must NOT be freed by the caller.
+ * cJSON_PrintToBuffer uses a caller-owned buffer (zero-initialize it, release with cJSON_PrintBufferRelease).
+ * cJSON_PrintThreadBuffer uses a buffer owned by the calling thread; the result is valid until the next
+ * cJSON_PrintThreadBuffer call on that thread. Threads that exit should call cJSON_ReleaseThreadBuffers.
+ * Set cJSON_InitHooks before the first print; buffers are allocated with the global hooks. */
+typedef struct cJSON_PrintBuffer
+{
+    char *buffer;
+    size_t size;
+} cJSON_PrintBuffer;
+CJSON_PUBLIC(char *) cJSON_PrintToBuffer(const cJSON *item, cJSON_PrintBuffer *buffer, cJSON_bool format, size_t *length);
+CJSON_PUBLIC(void) cJSON_PrintBufferRelease(cJSON_PrintBuffer *buffer);
+CJSON_PUBLIC(const char *) cJSON_PrintThreadBuffer(const cJSON *item, cJSON_bool format, size_t *length);
+CJSON_PUBLIC(void) cJSON_ReleaseThreadBuffers(void);
+
+/* CBOR (RFC 8949) encoding. Round-trips every cJSON type: integral numbers up to 2^53 are CBOR
+ * integers, other numbers single or double precision floats (whichever is exact), cJSON_Raw is
+ * tag 262 on a byte string. cJSON_PrintCBOR returns an allocated buffer (free with cJSON_free);
+ * cJSON_PrintThreadBufferCBOR renders into the same per-thread buffer as cJSON_PrintThreadBuffer.
+ * cJSON_ParseCBOR accepts any CBOR whose map keys are text strings, except chunked strings and
+ * untagged byte strings; the whole buffer must be one item. */
+CJSON_PUBLIC(unsigned char *) cJSON_PrintCBOR(const cJSON *item, size_t *length);
+CJSON_PUBLIC(const unsigned char *) cJSON_PrintThreadBufferCBOR(const cJSON *item, size_t *length);
+CJSON_PUBLIC(cJSON *) cJSON_ParseCBOR(const unsigned char *data, size_t length);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -172,6 +233,23 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+/* Index objects that grow past "children" items (0, the default, disables indexing).
+ * The index is built by the add/insert functions once an object passes the threshold and kept
+ * in sync by the add/insert/replace/detach/delete functions; lookups never modify it. Like the
+ * child list itself, it must not be read while another thread changes the object. Objects
+ * edited by relinking child/next/prev directly must not be indexed. */
+CJSON_PUBLIC(void) cJSON_SetIndexThreshold(size_t children);
+/* Key interning (off by default). Object keys created by cJSON_Parse* and cJSON_AddItemToObject
+ * are stored once and shared, marked cJSON_StringIsConst. cJSON_InternArena interns keys created
+ * inside an arena in a table released with the arena; cJSON_InternGlobal interns other keys in a
+ * process-wide table (at most CJSON_INTERN_MAX_KEYS keys of up to CJSON_INTERN_MAX_LENGTH bytes,
+ * kept until exit). Lookups compare key pointers before strings, so cJSON_InternKey a name once
+ * to look it up repeatedly. Code that frees or rewrites item->string itself must not enable this. */
+#define cJSON_InternArena 1
+#define cJSON_InternGlobal 2
+CJSON_PUBLIC(void) cJSON_SetKeyInterning(int tables);
+/* The shared copy of key, or key itself when it is not interned. */
+CJSON_PUBLIC(const char *) cJSON_InternKey(const char *key);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
@@ -293,6 +371,20 @@ CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
 CJSON_PUBLIC(void *) cJSON_malloc(size_t size);
 CJSON_PUBLIC(void) cJSON_free(void *object);
 
+/* Scoped arena allocation for short-lived trees (one request, one event).
+ * cJSON_ArenaBegin installs an arena on the calling thread; until the matching cJSON_ArenaEnd,
+ * every node, key and string value created by that thread is bump-allocated from it, and
+ * cJSON_ArenaEnd releases them all at once. cJSON_Delete on arena items is a no-op.
+ * Arenas nest. Printed strings and cJSON_malloc are never taken from an arena.
+ * Nothing allocated inside the arena may be kept after cJSON_ArenaEnd: build long-lived items
+ * between cJSON_ArenaSuspend and cJSON_ArenaResume (e.g. cJSON_Duplicate a result).
+ * block_size 0 selects the default (CJSON_ARENA_BLOCK_SIZE). */
+typedef struct cJSON_Arena cJSON_Arena;
+CJSON_PUBLIC(cJSON_Arena *) cJSON_ArenaBegin(size_t block_size);
+CJSON_PUBLIC(void) cJSON_ArenaEnd(cJSON_Arena *arena);
+CJSON_PUBLIC(void) cJSON_ArenaSuspend(void);
+CJSON_PUBLIC(void) cJSON_ArenaResume(void);
+
 #ifdef __cplusplus
 }
 #endif
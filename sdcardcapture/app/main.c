@@ -433,27 +433,8 @@ static gboolean do_capture_idle(gpointer user_data) {
    ═══════════════════════════════════════════════════════════════════════════ */
 
 static int Extract_Event_State(cJSON* event) {
-    const char* stateProperties[] = {
-        "active", "state", "triggered", "LogicalState",
-        "ready", "Open", "lost", "Detected", "recording",
-        "accessed", "connected", "day", "sensor_level",
-        "disruption", "alert", "fan_failure", "Failed",
-        "limit_exceeded", "abr_error", "tampering",
-        "signal_status_ok", "Playing", NULL
-    };
-    for (int i = 0; stateProperties[i]; i++) {
-        cJSON* item = cJSON_GetObjectItem(event, stateProperties[i]);
-        if (item) {
-            if (cJSON_IsBool(item))   return cJSON_IsTrue(item) ? 1 : 0;
-            if (cJSON_IsNumber(item)) return item->valueint ? 1 : 0;
-            if (cJSON_IsString(item)) {
-                if (strcmp(item->valuestring, "1") == 0 ||
-                    strcmp(item->valuestring, "true") == 0) return 1;
-                return 0;
-            }
-        }
-    }
-    return 1;
+    int state = ACAP_EVENTS_Event_State(event);
+    return state < 0 ? 1 : state;  /* Default to active without a state property */
 }
 
 void My_Event_Callback(cJSON* event, void* userdata) {
@@ -692,6 +673,8 @@ void HTTP_Endpoint_images(const ACAP_HTTP_Response response, const ACAP_HTTP_Req
 
             qsort(names, count, sizeof(char*), str_cmp);
 
+            /* One node set per listed image; release them all at once */
+            cJSON_Arena* arena = cJSON_ArenaBegin(16384);
             cJSON* arr = cJSON_CreateArray();
             for (int i = count - 1; i >= 0; i--) {  /* newest first */
                 char filepath[1024];
@@ -723,7 +706,7 @@ void HTTP_Endpoint_images(const ACAP_HTTP_Response response, const ACAP_HTTP_Req
             }
             free(names);
             ACAP_HTTP_Respond_JSON(response, arr);
-            cJSON_Delete(arr);
+            cJSON_ArenaEnd(arena);
             return;
         }
 
@@ -24,8 +24,10 @@ static cJSON* eventSubscriptions = NULL;
  * Thermometry VAPIX helpers
  *-----------------------------------------------------*/
 
+/* select: dotted path of the part of the response to build (e.g. "data.areaList"),
+ * or NULL for the whole response. "error" is always included. */
 static cJSON*
-Thermometry_Call(const char* method, cJSON* params) {
+Thermometry_Call(const char* method, cJSON* params, const char* select) {
 	cJSON* request = cJSON_CreateObject();
 	cJSON_AddStringToObject(request, "apiVersion", "1.0");
 	cJSON_AddStringToObject(request, "context", APP_PACKAGE);
@@ -35,15 +37,20 @@ Thermometry_Call(const char* method, cJSON* params) {
 	else
 		cJSON_AddItemToObject(request, "params", cJSON_CreateObject());
 
-	char* body = cJSON_PrintUnformatted(request);
+	const char* body = cJSON_PrintThreadBuffer(request, 0, NULL);
 	cJSON_Delete(request);
 
 	char* response = ACAP_VAPIX_Post("thermometry.cgi", body);
-	free(body);
 	if (!response)
 		return NULL;
 
-	cJSON* json = cJSON_Parse(response);
+	cJSON* json;
+	if (select) {
+		const char* paths[] = { select, "error" };
+		json = cJSON_ParseSelect(response, paths, 2);
+	} else {
+		json = cJSON_Parse(response);
+	}
 	free(response);
 	if (!json)
 		return NULL;
@@ -64,7 +71,7 @@ Thermometry_Call(const char* method, cJSON* params) {
 
 static void
 Publish_Area_Status(void) {
-	cJSON* json = Thermometry_Call("getAreaStatus", NULL);
+	cJSON* json = Thermometry_Call("getAreaStatus", NULL, "data.areaList");
 	if (!json)
 		return;
 
@@ -92,7 +99,7 @@ static void
 Publish_Spot_Temperature(void) {
 	cJSON* params = cJSON_CreateObject();
 	cJSON_AddStringToObject(params, "coordinateSystem", "coord_neg1_1");
-	cJSON* json = Thermometry_Call("getSpotTemperature", params);
+	cJSON* json = Thermometry_Call("getSpotTemperature", params, "data");
 	if (!json)
 		return;
 
@@ -170,7 +177,7 @@ Apply_Temperature_Scale(void) {
 
 	cJSON* params = cJSON_CreateObject();
 	cJSON_AddStringToObject(params, "unit", scale);
-	cJSON* json = Thermometry_Call("setTemperatureScale", params);
+	cJSON* json = Thermometry_Call("setTemperatureScale", params, "data");
 	if (json) {
 		LOG("Temperature scale set to %s\n", scale);
 		ACAP_STATUS_SetString("thermometry", "scale", scale);